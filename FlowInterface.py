@@ -37,67 +37,139 @@ class FlowInterface:
 
     def handle_client(self, client_socket):
         # Process client commands
+        # Bytes received but not handled yet -- frames and commands can share a read or span several
+        pending = b""
         try:
             while True:
-                data = client_socket.recv(1024).decode("utf-8")
-                log.info("Received command: %s", data)
+                raw = client_socket.recv(1024)
 
-                result = [ 0, 0, 0, 0, 0, 0 ]  # Initialize
-
-                if not data:
+                if not raw:
                     log.info("Client %s:%s disconnected.", client_socket.getpeername()[0], client_socket.getpeername()[1])
                     break
 
-                if (data == None):
-                    log.error("Received malformed/empty data.")
-                    continue
-
-                # Ensure data consistency
-                data = data.strip()
-                data = data.replace(" ", "")  # Remove spaces
-                data = data.replace("\n", "")  # Remove newlines
-                data = data.replace("\r", "")  # Remove carriage returns
-                data = data.replace("\t", "")  # Remove tabs
-                
-                # Parse listflows version of the command
-                if (data.startswith("listflows")):
-                    result = data.split("-")
-                    result = [ result[0], result[1], 0, 0, 0, result[2] ]
-
-                # Parse the command, returns a set with {command, srcDPID, output_port, nw_src, Wildcards, XID}
-                if (result == [0, 0, 0, 0, 0, 0]):
-                    result = self.parse_data(data)
-
-                if (result == None):
-                    log.error("Error parsing data: %s", data)
-                    continue
-                
-                srcDPID = int(result[1])
-                outPort = int(result[2])
-                xid = int(result[5])
-
-                # Create match object from our nw_src, Wildcards and dstDPID
-                match = of.ofp_match()
-                match.nw_proto = 0x06  # TCP
-                match.nw_src = result[3]
-                match.wildcards = result[4]
-                match.dl_type = 0x0800  # IPv4
-
-                # Create action object based on srcDPID and dstDPID
-                action = of.ofp_action_output(port=outPort)
-
-                # Apply commands via controller
-                if result[0] == "addflow":
-                    self.add_flow(srcDPID, match, action, xid)
-                elif result[0] == "removeflow":
-                    self.remove_flow(srcDPID, match, action, xid)
-                elif result[0] == "listflows":
-                    self.list_flows(srcDPID, xid)
+                # Split the stream on frame and command boundaries, keep a partial one for the next read
+                pending += raw
+                while pending:
+                    # Pre-encoded OpenFlow messages -- forward every complete frame untouched
+                    if pending.startswith(b"ofmsg-"):
+                        rest = self.forward_messages(pending)
+                        if rest == pending:
+                            break
+                        pending = rest
+                        continue
+
+                    # Could still turn into a frame header
+                    if b"ofmsg-".startswith(pending):
+                        break
+
+                    # Anything else is a newline-terminated text command
+                    command, newline, rest = pending.partition(b"\n")
+                    if not newline:
+                        if len(pending) > 1024:
+                            log.error("Dropping unterminated command.")
+                            pending = b""
+                        break
+
+                    pending = rest
+                    self.handle_command(command.decode("utf-8", errors="replace"))
         except Exception as e:
             log.error("Error handling client: %s", e)
         finally:
             client_socket.close()
 
+    def handle_command(self, data):
+        log.info("Received command: %s", data)
+
+        result = [ 0, 0, 0, 0, 0, 0 ]  # Initialize
+
+        if (data == None):
+            log.error("Received malformed/empty data.")
+            return
+
+        # Ensure data consistency
+        data = data.strip()
+        data = data.replace(" ", "")  # Remove spaces
+        data = data.replace("\n", "")  # Remove newlines
+        data = data.replace("\r", "")  # Remove carriage returns
+        data = data.replace("\t", "")  # Remove tabs
+
+        # Nothing left to run
+        if (data == ""):
+            return
+
+        # Parse listflows version of the command
+        if (data.startswith("listflows")):
+            result = data.split("-")
+            result = [ result[0], result[1], 0, 0, 0, result[2] ]
+
+        # Parse the command, returns a set with {command, srcDPID, output_port, nw_src, Wildcards, XID}
+        if (result == [0, 0, 0, 0, 0, 0]):
+            result = self.parse_data(data)
+
+        if (result == None):
+            log.error("Error parsing data: %s", data)
+            return
+
+        srcDPID = int(result[1])
+        outPort = int(result[2])
+        xid = int(result[5])
+
+        # Create match object from our nw_src, Wildcards and dstDPID
+        match = of.ofp_match()
+        match.nw_proto = 0x06  # TCP
+        match.nw_src = result[3]
+        match.wildcards = result[4]
+        match.dl_type = 0x0800  # IPv4
+
+        # Create action object based on srcDPID and dstDPID
+        action = of.ofp_action_output(port=outPort)
+
+        # Apply commands via controller
+        if result[0] == "addflow":
+            self.add_flow(srcDPID, match, action, xid)
+        elif result[0] == "removeflow":
+            self.remove_flow(srcDPID, match, action, xid)
+        elif result[0] == "listflows":
+            self.list_flows(srcDPID, xid)
+
+    def forward_messages(self, buffer):
+
+        #    ---Format of received frame---
+        # ofmsg-switchDPID-length\n followed by length bytes of OpenFlow message
+        # Forwards every complete frame at the front of buffer and returns the rest
+        while buffer.startswith(b"ofmsg-"):
+            header, newline, rest = buffer.partition(b"\n")
+            if not newline:
+                # Header not complete yet, unless it's far too long to be one
+                if len(header) > 64:
+                    log.error("Dropping malformed OpenFlow frame header.")
+                    return b""
+                break
+
+            try:
+                args = header.decode("utf-8").split("-")
+                dpid = int(args[1])
+                length = int(args[2])
+            except Exception as e:
+                # Without a length the frame boundaries are lost
+                log.error("Error parsing OpenFlow frame header: %s", e)
+                return b""
+
+            # Wait for the rest of the body
+            if len(rest) < length:
+                break
+
+            body, buffer = rest[:length], rest[length:]
+            try:
+                self.switches[dpid].send(body)
+            except Exception as e:
+                log.error("Error forwarding OpenFlow message to switch %s: %s", dpid, e)
+                continue
+
+            log.info("Forwarded %s byte OpenFlow message to switch %s", length, dpid)
+
+        return buffer
+
     def parse_data(self, data):
 
         #    ---Format of received data---
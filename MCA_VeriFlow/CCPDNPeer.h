@@ -0,0 +1,52 @@
+#ifndef CCPDNPEER_H
+#define CCPDNPEER_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include "FrameBuffer.h"
+
+/// One connection to another CCPDN instance.
+///
+/// Everything known about a connected socket lives here -- which instance it belongs to, what the peer
+/// agreed to in its greeting and its partially received frames -- so closing the socket drops all of it
+/// at once. Outbound peers (we connected to them) are the ones we reconnect when the connection is lost.
+///
+/// Peers are shared through CCPDNPeerHandle. A handle stays tied to its own connection: once the peer is
+/// closed, sends through an old handle fail instead of reaching whatever connection reuses the descriptor.
+
+struct CCPDNPeer {
+	typedef std::chrono::steady_clock Clock;
+
+	// Fixed for the life of the peer
+	int					socket = -1;
+	bool				outbound = false;		// We connected, so we reconnect
+
+	// Guarded by Controller::ccpdnMutex
+	int					topologyIndex = -1;		// -1 until the greeting arrives
+	bool				binary = false;			// Peer agreed to binary digests
+	bool				delta = false;			// Peer agreed to versioned topology sync
+	bool				heartbeat = false;		// Peer sends heartbeats, so silence means it's gone
+	Clock::time_point	lastReceived = Clock::now();
+	Clock::time_point	lastSent = Clock::now();
+	FrameBuffer			frames;
+
+	// Serializes writes to this peer only, a stalled peer never holds up the others
+	std::mutex			sendMutex;
+	// Set (under sendMutex) once the socket is closed
+	bool				closed = false;
+	// Set (under sendMutex) once our framing marker went out, frames sent after it are length-prefixed
+	bool				lengthFramed = false;
+};
+
+typedef std::shared_ptr<CCPDNPeer> CCPDNPeerHandle;
+
+/// Reconnect schedule for an outbound peer, doubled after every failed attempt.
+struct CCPDNBackoff {
+	std::chrono::milliseconds			delay{0};
+	CCPDNPeer::Clock::time_point		nextAttempt;
+	// A connect() to this instance is under way, nobody else may start one
+	bool								connecting = false;
+};
+
+#endif
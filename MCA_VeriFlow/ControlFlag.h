@@ -0,0 +1,62 @@
+#ifndef CONTROLFLAG_H
+#define CONTROLFLAG_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+/// Boolean shared between threads that can also be waited on.
+///
+/// Reads and writes are atomic (acquire/release), so a flag set on one thread is seen on the others and
+/// the compiler can't hoist the load out of a loop. Threads that need a particular value block in
+/// waitFor() instead of polling with sleeps. Setting the value it already holds is a single atomic
+/// exchange, waiters are only notified on an actual change.
+
+class ControlFlag {
+	public:
+		ControlFlag(bool initial = false) : value(initial) {}
+
+		ControlFlag(const ControlFlag&) = delete;
+		ControlFlag& operator=(const ControlFlag&) = delete;
+
+		// Plain bool syntax, so flags read like the bools they replace
+		ControlFlag& operator=(bool update) {
+			set(update);
+			return *this;
+		}
+		operator bool() const { return get(); }
+
+		bool get() const { return value.load(std::memory_order_acquire); }
+
+		void set(bool update) {
+			if (value.exchange(update, std::memory_order_acq_rel) == update) {
+				return;
+			}
+
+			// Pass through the mutex so a waiter can't miss the change between its check and its sleep
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+			}
+			cv.notify_all();
+		}
+
+		// Block until the flag holds target
+		void waitFor(bool target) const {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this, target]() { return get() == target; });
+		}
+
+		// Block until the flag holds target or the timeout passes, returns true if it holds target
+		bool waitFor(bool target, std::chrono::milliseconds timeout) const {
+			std::unique_lock<std::mutex> lock(mutex);
+			return cv.wait_for(lock, timeout, [this, target]() { return get() == target; });
+		}
+
+	private:
+		std::atomic<bool> value;
+		mutable std::mutex mutex;
+		mutable std::condition_variable cv;
+};
+
+#endif
@@ -1,41 +1,15 @@
 #include "Controller.h"
 #include <thread>
 
-bool TCPAnalyzer::pingFlag = false;
-std::vector<TimestampPacket> TCPAnalyzer::currentPackets;
-std::mutex TCPAnalyzer::currentPacketsMutex;
-bool Controller::pauseOutput = false;
-std::mutex Controller::sharedFlowsMutex;
-
-// Use \0 as delimiter and split a concatenated packet into smaller packets
-std::vector<std::string> splitPcktInput(const std::string& input) {
-    std::vector<std::string> words;
-    std::string word;
-
-    // Iterate through the input string
-    for (size_t i = 0; i < input.length(); i++) {
-        if (input[i] == '\0') {
-            // If we encounter the delimiter, add the current word to the vector
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
-            }
-        } else {
-            // Otherwise, add the character to the current word
-            word += input[i];
-        }
-    }
-
-    // Add the last word if it's not empty
-    if (!word.empty()) {
-        words.push_back(word);
-    }
-
-    return words;
-}
+std::atomic<bool> TCPAnalyzer::pingFlag(false);
+PacketRing TCPAnalyzer::currentPackets(PACKET_RING_SLOTS, PACKET_SLOT_SIZE);
+std::mutex TCPAnalyzer::pingMutex;
+std::condition_variable TCPAnalyzer::pingCV;
+ControlFlag Controller::pauseOutput(false);
+std::mutex Controller::ccpdnMutex;
 
 // MAIN THREADS
-void Controller::controllerThread(bool* run)
+void Controller::controllerThread(std::atomic<bool>* run)
 {
 	loggy << "[CCPDN]: Starting controller thread...\n";
 	while (*run) {
@@ -52,10 +26,8 @@ void Controller::controllerThread(bool* run)
 		// }
 
 		// Use pause flag to hold off on using rstControllerFlag until command says its ok
-		// Only command that does this is "retrieveFlows"
-		while(pause_rst) {
-			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-		}
+		// Only command that does this is "retrieveFlows" -- it always clears the flag before returning
+		pause_rst.waitFor(false);
 
 		// Reset the flag once we are finished parsing everything
 		if (!noRst) {
@@ -64,212 +36,280 @@ void Controller::controllerThread(bool* run)
 	}
 }
 
-void Controller::flowHandlerThread(bool *run)
+void Controller::flowHandlerThread(std::atomic<bool>* run)
 {
 	loggy << "[CCPDN]: Starting flow handler thread...\n";
 	pauseOutput = false;
-	while (*run) {
 
-		// Clear our current flow list
-		tryClearSharedFlows();
-		std::vector<byte> currPacket;
+	// Reused across iterations -- pop() swaps buffers with the ring instead of allocating
+	TimestampPacket currPacket;
+	// Likewise traded with the sharedFlows back buffer on every drain
+	std::vector<Flow> pendingFlows;
 
-		{
-			// Lock mutex to ensure thread safety
-			std::lock_guard<std::mutex> lock(TCPAnalyzer::currentPacketsMutex);
-			if (!TCPAnalyzer::currentPackets.empty()) {
-				// Get the packet with the lowest timestamp
-				auto it = std::min_element(TCPAnalyzer::currentPackets.begin(), TCPAnalyzer::currentPackets.end(),
-					[](const TimestampPacket& a, const TimestampPacket& b) {
-						return a.smallerTime(b);
-					});
-				currPacket = it->data;
-				TCPAnalyzer::currentPackets.erase(it);
-			}
+	while (*run) {
+
+		// Sleep until the packet capture or a flow command gives us something to do
+		if (TCPAnalyzer::currentPackets.empty() && sharedFlows.empty()) {
+			TCPAnalyzer::waitForPing(run, std::chrono::milliseconds(1000));
 		}
 
+		// Take the oldest captured packet (arrival order is timestamp order)
+		currPacket.data.clear();
+		TCPAnalyzer::currentPackets.pop(currPacket);
+
 		// Parse packet with scrutiny to XID
-		parsePacket(currPacket, true);
-
-		// Create optimal vector of flows to parse -- remove duplicates
-		std::vector<Flow> operatingFlows = sharedFlows;
-		auto end = std::unique(operatingFlows.begin(), operatingFlows.end());
-		operatingFlows.erase(end, operatingFlows.end());
-		// Erase all "empty" flows
-		Flow empty("", "", "", false);
-		operatingFlows.erase(std::remove(operatingFlows.begin(), operatingFlows.end(), empty), operatingFlows.end());
+		parsePacket(currPacket.data, true);
+
+		// Take every flow pushed since the last pass -- anything pushed while we work lands in the next batch
+		sharedFlows.drain(pendingFlows);
+
+		// Create optimal vector of flows to parse -- remove duplicates (anywhere in the list) and "empty" flows
+		// Identity ignores add/remove, so the last occurrence of each rule is the one kept (an add then a remove ends removed)
+		std::vector<Flow> operatingFlows;
+		std::unordered_set<Flow> seen;
+		seen.reserve(pendingFlows.size());
+		operatingFlows.reserve(pendingFlows.size());
+		for (auto it = pendingFlows.rbegin(); it != pendingFlows.rend(); ++it) {
+			if (!it->isEmptyFlow() && seen.insert(*it).second) {
+				operatingFlows.push_back(*it);
+			}
+		}
+		std::reverse(operatingFlows.begin(), operatingFlows.end());
 		
-		// Handle all received flows
+		// Handle all received flows -- purely local verifications are collected and sent to VeriFlow in one batch
+		std::vector<Flow> verifyBatch;
 		for (Flow f : operatingFlows) {
+			if (isLocalVerification(f)) {
+				verifyBatch.push_back(f);
+				continue;
+			}
 			parseFlow(f);
 		}
+		if (!verifyBatch.empty()) {
+			verifyFlowBatch(verifyBatch);
+		}
 
 		// Reset flags
-		if (!fhFlag && !forceStopShared) {
-			recvSharedFlag = true;
-		}
 		pauseOutput = false;
 	}
 }
 
-/// This method should setup the server receiver for CCPDN communication
-void Controller::CCPDNThread(bool *run)
+// How do we handle received digests? (Call verification functions, topology updates or synchroncity)
+void Controller::recvProcessCCPDN(int socket)
 {
-	// Handles receiving packets from currently connected sockCC connections (CCPDN connections)
-	loggy << "[CCPDN]: Starting CCPDN message listener thread...\n";
-	
-	while (*run) {
-		// Check if we have any connections to read from by using select()
-		#ifdef __unix__
-		fd_set read_sockets;
-		FD_ZERO(&read_sockets);
-		int max_read = -1;
-
-		// Add current sockets to our monitoring list
-		for (int currentSock : acceptedCC) {
-			FD_SET(currentSock, &read_sockets);
-			if (currentSock > max_read) {
-				max_read = currentSock;
-			}
-		}
+	std::vector<std::string> packets;
+	CCPDNPeerHandle peer;
 
-		// Create a 1 second timeout incase we have a new connection on acceptedCC
-		struct timeval timeout;
-		timeout.tv_sec = 1;
-		timeout.tv_usec = 0;
+#ifdef __unix__
+	uint8_t chunk[CCPDN_RECV_CHUNK_SIZE];
+	ssize_t bytes_received = 0;
+	int recvError = 0;
+	bool corrupt = false;
+	{
+		// Read while the socket is known to belong to this peer -- it can't be closed (and its number reused) under the lock
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		auto it = ccpdnPeers.find(socket);
+		if (it == ccpdnPeers.end()) {
+			return;
+		}
+		peer = it->second;
 
-		// Monitor all sockets with a timeout of 1 second
-		int activity = select(max_read + 1, &read_sockets, nullptr, nullptr, &timeout);
+		bytes_received = recv(socket, chunk, sizeof(chunk), MSG_DONTWAIT);
+		recvError = errno;
+		if (bytes_received > 0) {
+			// Any traffic counts as a sign of life
+			peer->lastReceived = CCPDNPeer::Clock::now();
 
-		// Select() had an error -- add to error count
-		if (activity < 0) {
-			continue;
-		} else if (activity == 0) { // No activity on sockets
-			continue;
-		}
+			// Add only the bytes we received to this socket's buffer and take every frame it now completes
+			FrameBuffer& frames = peer->frames;
+			frames.append(chunk, bytes_received);
 
-		// If we are at this point, theres data on a socket. Find it and do recv() and parse it
-		for (int currentSock : acceptedCC) {
-			if (FD_ISSET(currentSock, &read_sockets)) {
-				recvProcessCCPDN(currentSock);
+			std::string payload;
+			while (frames.next(payload)) {
+				// The peer's marker is its last NUL-delimited frame, whatever follows it is length-prefixed
+				if (!frames.isLengthPrefixed() && payload == "F" + std::to_string(CCPDN_FRAMING_VERSION)) {
+					frames.setLengthPrefixed();
+				}
+				packets.push_back(std::move(payload));
 			}
+			corrupt = frames.isCorrupt();
 		}
-
-		#endif
 	}
-}
 
-// How do we handle received digests? (Call verification functions, topology updates or synchroncity)
-void Controller::recvProcessCCPDN(int socket)
-{
-	// Clear packet and fix size before receival
-	int hostIndex = referenceTopology->hostIndex;
-	std::vector<uint8_t> packet;
-	packet.clear();
-	packet.resize(4096);
-
-#ifdef __unix__
-	ssize_t bytes_received = recv(socket, packet.data(), packet.size(), 0);
 	if (bytes_received < 0) {
+		// Nothing to read after all -- wait for the next readiness event
+		if (recvError == EINTR || recvError == EAGAIN || recvError == EWOULDBLOCK) {
+			return;
+		}
 		loggyErr("[CCPDN-ERROR]: Failed to receive message from CCPDN instance\n");
+		closePeer(peer);
 		return;
 	} else if (bytes_received == 0) {
 		loggyErr("[CCPDN-ERROR]: Connection closed by CCPDN instance\n");
 		// Remove socket from mapping and list of accepted connections
-		closeAcceptedSocket(socket);
+		closePeer(peer);
 		return;
 	}
-#endif
 
-	// Skip empty packets
-	if (packet.empty()) {
+	// A bogus length means we've lost the frame boundaries, the stream can't be trusted past this point
+	if (corrupt) {
+		loggyErr("[CCPDN-ERROR]: Received an oversized frame, dropping CCPDN connection\n");
+		closePeer(peer);
 		return;
 	}
+#endif
 
-	// Ensure we are only looking at single packets, and begin JSON parsing
-	std::string rawData(packet.begin(), packet.end());
-	std::vector<std::string> packets = splitPcktInput(rawData);
+	for (const std::string& packet_str : packets) {
+		// Heartbeat -- already counted as traffic above, nothing else to do
+		if (packet_str == "H") {
+			continue;
+		}
 
-	for (std::string packet_str : packets) {
-		// Check if we have a port number in the packet string
+		// Check if we have a port number in the packet string -- "P<index>", optionally followed by ":B<version>"
 		if (packet_str.size() > 1 && packet_str[0] == 'P') {
 			int connectingIndex = -1;
+			int framingVersion = 0;
+			int binaryVersion = 0;
+			int deltaVersion = 0;
+			int heartbeatVersion = 0;
 			try {
 				connectingIndex = std::stoi(packet_str.substr(1, packet_str.size() - 1));
+				size_t framingPos = packet_str.find(":F");
+				if (framingPos != std::string::npos) {
+					framingVersion = std::stoi(packet_str.substr(framingPos + 2));
+				}
+				size_t binaryPos = packet_str.find(":B");
+				if (binaryPos != std::string::npos) {
+					binaryVersion = std::stoi(packet_str.substr(binaryPos + 2));
+				}
+				size_t deltaPos = packet_str.find(":D");
+				if (deltaPos != std::string::npos) {
+					deltaVersion = std::stoi(packet_str.substr(deltaPos + 2));
+				}
+				size_t heartbeatPos = packet_str.find(":H");
+				if (heartbeatPos != std::string::npos) {
+					heartbeatVersion = std::stoi(packet_str.substr(heartbeatPos + 2));
+				}
 			} catch (std::exception& e) {
-				return;
+				continue;
 			}
 
-			acceptedCC.push_back(socket);
-			mapSocketToIndex(&acceptedCC.back(), connectingIndex);
+			// Socket was registered when it was accepted, only its instance is new
+			mapPeerToIndex(peer, connectingIndex);
 			loggy << "[CCPDN]: Established connection with CCPDN Instance #" << connectingIndex << std::endl;
-			return;
+
+			// Peer reads length-prefixed frames -- switch what we send, our marker tells it to switch its reader
+			// Older peers never ask, so their connection stays NUL-delimited in both directions
+			bool lengthFramed = (framingVersion == CCPDN_FRAMING_VERSION) && startLengthFraming(peer);
+
+			// Peer speaks our binary format -- use it both ways and tell them so (binary digests can hold NUL bytes, so only over length prefixes)
+			if (binaryVersion == DIGEST_BINARY_VERSION && lengthFramed) {
+				enablePeerOption(peer, &CCPDNPeer::binary);
+				sendCCPDNMessage(peer, "B" + std::to_string(DIGEST_BINARY_VERSION));
+			}
+
+			// Same for versioned topology sync
+			if (deltaVersion == TOPOLOGY_DELTA_VERSION) {
+				enablePeerOption(peer, &CCPDNPeer::delta);
+				sendCCPDNMessage(peer, "D" + std::to_string(TOPOLOGY_DELTA_VERSION));
+			}
+
+			// And heartbeats, from here on a silent peer is a dead one
+			if (heartbeatVersion == CCPDN_HEARTBEAT_VERSION) {
+				enablePeerOption(peer, &CCPDNPeer::heartbeat);
+				sendCCPDNMessage(peer, "H" + std::to_string(CCPDN_HEARTBEAT_VERSION));
+			}
+			continue;
 		}
 
-		loggy << "[CCPDN]: Received packet:\n" << packet_str << std::endl;
+		// Marker from the other side -- it agreed to length prefixes (or answered ours), make sure we send them too
+		if (packet_str.size() > 1 && packet_str[0] == 'F') {
+			if (packet_str == "F" + std::to_string(CCPDN_FRAMING_VERSION)) {
+				startLengthFraming(peer);
+			}
+			continue;
+		}
 
-		Digest packetDigest;
-		packetDigest.fromJson(packet_str);
+		// Reply to our greeting -- the accepting instance agreed to binary digests
+		if (packet_str.size() > 1 && packet_str[0] == 'B') {
+			if (packet_str == "B" + std::to_string(DIGEST_BINARY_VERSION)) {
+				enablePeerOption(peer, &CCPDNPeer::binary);
+			}
+			continue;
+		}
+
+		// Reply to our greeting -- the accepting instance agreed to versioned topology sync
+		if (packet_str.size() > 1 && packet_str[0] == 'D') {
+			if (packet_str == "D" + std::to_string(TOPOLOGY_DELTA_VERSION)) {
+				enablePeerOption(peer, &CCPDNPeer::delta);
+			}
+			continue;
+		}
 
-#define TOPOLOGY_UPDATE_MASTER 0
-#define TOPOLOGY_UPDATE_SYNC 1
-#define PERFORM_VERIFICATION_REQ 2
-#define VERIFICATION_SUCCESS 3
-#define VERIFICATION_FAIL 4
-#define FLOW_LIST_REQUEST 5
-#define FLOW_LIST_RESPONSE 6
+		// Reply to our greeting -- the accepting instance agreed to heartbeats
+		if (packet_str.size() > 1 && packet_str[0] == 'H') {
+			if (packet_str == "H" + std::to_string(CCPDN_HEARTBEAT_VERSION)) {
+				enablePeerOption(peer, &CCPDNPeer::heartbeat);
+			}
+			continue;
+		}
+
+		if (Digest::isBinary(packet_str)) {
+			loggy << "[CCPDN]: Received binary digest (" << packet_str.size() << " bytes)" << std::endl;
+		} else {
+			loggy << "[CCPDN]: Received packet:\n" << packet_str << std::endl;
+		}
+
+		// Decode once -- the kind and every field below come off the decoded digest
+		Digest packetDigest;
+		if (!packetDigest.decode(packet_str)) {
+			loggy << "[CCPDN-ERROR]: Received an incorrectly formatted digest" << std::endl;
+			continue;
+		}
 
 		Flow packetFlow = packetDigest.getFlow();
-		Flow inverseFlow = packetFlow.inverseFlow();
 		int returnIndex = packetDigest.getHostIndex();
-		int returnSocket = *getSocketFromIndex(returnIndex);
 
 		// Define other vars outside switch statement
 		std::vector<Flow> requestedFlows;
 		std::string requestPayload = packetDigest.getPayload();
-		std::string flowListResponse = "";
-		Digest flowListMsg;
 		std::vector<std::string> partsList;
 
 		// Based on code returned, apply functionality
-		switch (Digest::readDigest(packet_str)) {
+		switch (packetDigest.getKind()) {
+
+			case Digest::TOPOLOGY_UPDATE_MASTER: {
+				// Payload "v<version>" is the requester's version of our topology (anything else gets a snapshot)
+				uint64_t knownVersion = TOPOLOGY_VERSION_UNKNOWN;
+				if (requestPayload.size() > 1 && requestPayload[0] == 'v') {
+					try {
+						knownVersion = std::stoull(requestPayload.substr(1));
+					} catch (std::exception& e) {
+						knownVersion = TOPOLOGY_VERSION_UNKNOWN;
+					}
+				}
 
-			case TOPOLOGY_UPDATE_MASTER: {
 				loggy << "[CCPDN]: Sending update to topology " << returnIndex << std::endl;
-				sendUpdate(false, returnIndex);
+				sendUpdate(false, returnIndex, knownVersion);
 				break;
 			}
 
-			case TOPOLOGY_UPDATE_SYNC: {
+			case Digest::TOPOLOGY_UPDATE_SYNC: {
 				loggy << "[CCPDN]: Updating current topology to synchronize with topology " << returnIndex << std::endl;
 				synchTopology(packetDigest);
 				break;
 			}
 
-			case PERFORM_VERIFICATION_REQ: {
-				// Make sure we aren't working with an empty flow
-				if (packetFlow.isEmptyFlow()) {
-					loggy << "[CCPDN]: Received empty flow for verification request" << std::endl;
-					break;
-				}
-
-				loggy << "[CCPDN]: Performing verification request for topology " << returnIndex << std::endl;
-				bool result = performVerification(true, packetFlow);
-				if (result) {
-					// Send the success message back to the CCPDN instance
-					Digest success = Digest(false, true, true, hostIndex, returnIndex, "");
-					success.appendFlow(packetFlow);
-					sendCCPDNMessage(returnSocket, success.toJson());
-				} else {
-					Digest fail = Digest(true, true, true, hostIndex, returnIndex, "");
-					fail.appendFlow(packetFlow);
-					sendCCPDNMessage(returnSocket, fail.toJson());			
-				}
+			case Digest::PERFORM_VERIFICATION_REQ:
+			case Digest::FLOW_LIST_REQUEST: {
+				// Answering waits on VeriFlow or the flow handler -- the request worker does it so replies keep being read
+				peerRequests.push(packetDigest);
+				peerRequestsReady = true;
 				break;
 			}
 
 
-			case VERIFICATION_SUCCESS: {
+			case Digest::VERIFICATION_SUCCESS: {
 				// Make sure we aren't working with an empty flow
 				if (packetFlow.isEmptyFlow()) {
 					loggy << "[CCPDN]: Received empty flow for successful verification" << std::endl;
@@ -278,14 +318,14 @@ void Controller::recvProcessCCPDN(int socket)
 				loggy << "[CCPDN]: Verification results for flow:" << std::endl;
 				loggy << "Flow: " << packetFlow.flowToStr(false) << " [SUCCESS]" << std::endl;
 
-				// Push back to success vector if we are receiving
-				if (ALLOW_CCPDN_RECV) {
-					CCPDN_FLOW_SUCCESS.push_back(packetFlow);
+				// Resolve the matching request -- replies to requests we gave up on are dropped
+				if (!pendingVerifications.complete(packetDigest.getRequestID(), true)) {
+					loggy << "[CCPDN]: No pending request for verification result (ID " << packetDigest.getRequestID() << ")" << std::endl;
 				}
 				break;
 			}
 
-			case VERIFICATION_FAIL: {
+			case Digest::VERIFICATION_FAIL: {
 				// Make sure we aren't working with an empty flow
 				if (packetFlow.isEmptyFlow()) {
 					loggy << "[CCPDN]: Received empty flow for failed verification" << std::endl;
@@ -294,40 +334,18 @@ void Controller::recvProcessCCPDN(int socket)
 				loggy << "[CCPDN]: Verification results for flow:" << std::endl;
 				loggy << "Flow: " << packetFlow.flowToStr(false) << " [FAIL]" << std::endl;
 
-				// Push back to failure vector if we are receiving
-				if (ALLOW_CCPDN_RECV) {
-					CCPDN_FLOW_FAIL.push_back(packetFlow);
+				// Resolve the matching request -- replies to requests we gave up on are dropped
+				if (!pendingVerifications.complete(packetDigest.getRequestID(), false)) {
+					loggy << "[CCPDN]: No pending request for verification result (ID " << packetDigest.getRequestID() << ")" << std::endl;
 				}
 				break;
 			}
 
-			case FLOW_LIST_REQUEST: {
-				requestedFlows = retrieveFlows(requestPayload, false); // Should contain IP
-				flowListResponse = "";
-
-				// If the "-" causes parsing issues, get rid of the delimiter being added at the end
-				for (Flow f : requestedFlows) {
-					flowListResponse += f.flowToStr(false) + "-";
-				}
-
-				flowListMsg = Digest(true, true, false, hostIndex, returnIndex, flowListResponse);
-				sendCCPDNMessage(returnSocket, flowListMsg.toJson());
-				break;
-			}
-
-			case FLOW_LIST_RESPONSE: {
-
-				// If CCPDN_FLOW_RESPONSE isn't empty, wait until it is cleared
-				// If we get stuck infinitely/not parsing CCPDN messages then its because of this
-				// Whatever utilizes CCPDN_FLOW_RESPONSE, should clear ASAP after use
-				while  (CCPDN_FLOW_RESPONSE.size() > 0) {
-					std::this_thread::sleep_for(std::chrono::milliseconds(100));
-				}
-
+			case Digest::FLOW_LIST_RESPONSE: {
 				requestPayload = packetDigest.getPayload(); // Contains flowlist
 				partsList = Flow::splitFlowString(requestPayload);
 
-				// Every 3 'parts' is a flow, combine them, form a flow then add it to CCPDN_FLOW_RESPONSE
+				// Every 3 'parts' is a flow, combine them, form a flow then add it to the response list
 				for (int i = 0; i < partsList.size(); i += 3) {
 					if (i + 2 >= partsList.size()) {
 						break; // Avoid out-of-bounds access
@@ -336,9 +354,13 @@ void Controller::recvProcessCCPDN(int socket)
 					std::string rulePrefix = partsList[i + 1];
 					std::string nextHopIP = partsList[i + 2];
 					Flow f(switchIP, rulePrefix, nextHopIP, true);
-					CCPDN_FLOW_RESPONSE.push_back(f);
+					requestedFlows.push_back(f);
 				}
 
+				// Hand the list straight to whoever is waiting on this request -- wakes them immediately
+				if (!pendingFlowLists.complete(packetDigest.getRequestID(), requestedFlows)) {
+					loggy << "[CCPDN]: No pending request for flow list (ID " << packetDigest.getRequestID() << ")" << std::endl;
+				}
 				break;
 			}
 
@@ -349,6 +371,72 @@ void Controller::recvProcessCCPDN(int socket)
 	}
 }
 
+/// Answers requests from other CCPDN instances, these block on VeriFlow or the flow handler so they never run on the reactor
+void Controller::CCPDNRequestThread(std::atomic<bool>* run)
+{
+	loggy << "[CCPDN]: Starting request worker..." << std::endl;
+	std::vector<Digest> requests;
+	while (*run) {
+		// The timeout only exists to notice run being cleared
+		if (!peerRequestsReady.waitFor(true, std::chrono::milliseconds(CCPDN_REACTOR_TIMEOUT_MS))) {
+			continue;
+		}
+
+		// Clear before draining -- a request pushed after this raises the flag again for the next pass
+		peerRequestsReady = false;
+		peerRequests.drain(requests);
+		for (Digest& request : requests) {
+			handlePeerRequest(request);
+		}
+	}
+}
+
+void Controller::handlePeerRequest(Digest& request)
+{
+	int hostIndex = referenceTopology->hostIndex;
+	Flow packetFlow = request.getFlow();
+	int returnIndex = request.getHostIndex();
+
+	switch (request.getKind()) {
+
+		case Digest::PERFORM_VERIFICATION_REQ: {
+			// Make sure we aren't working with an empty flow
+			if (packetFlow.isEmptyFlow()) {
+				loggy << "[CCPDN]: Received empty flow for verification request" << std::endl;
+				break;
+			}
+
+			loggy << "[CCPDN]: Performing verification request for topology " << returnIndex << std::endl;
+			bool result = performVerification(packetFlow);
+
+			// Send the result back to the CCPDN instance -- echo the request ID so it resolves the right request
+			Digest reply = Digest(!result, true, true, hostIndex, returnIndex, "");
+			reply.appendFlow(packetFlow);
+			reply.setRequestID(request.getRequestID());
+			sendCCPDNDigest(getPeer(returnIndex), reply);
+			break;
+		}
+
+		case Digest::FLOW_LIST_REQUEST: {
+			std::vector<Flow> requestedFlows = retrieveFlows(request.getPayload(), false); // Should contain IP
+			std::string flowListResponse = "";
+
+			// If the "-" causes parsing issues, get rid of the delimiter being added at the end
+			for (Flow f : requestedFlows) {
+				flowListResponse += f.flowToStr(false) + "-";
+			}
+
+			Digest flowListMsg = Digest(true, true, false, hostIndex, returnIndex, flowListResponse);
+			flowListMsg.setRequestID(request.getRequestID());
+			sendCCPDNDigest(getPeer(returnIndex), flowListMsg);
+			break;
+		}
+
+		default:
+			break;
+	}
+}
+
 /// This method should establish a connection to each CCPDN instance within the topology file
 bool Controller::initCCPDN()
 {
@@ -362,24 +450,58 @@ bool Controller::initCCPDN()
 			continue;
 		}
 
-		// Skip any instances we've already connected to
-		if (socketTopologyMap.find(i) != socketTopologyMap.end()) {
-			continue;
+		// Asked for explicitly, so don't wait out the backoff
+		{
+			std::lock_guard<std::mutex> lock(ccpdnMutex);
+			auto backoff = ccpdnReconnects.find(i);
+			if (backoff != ccpdnReconnects.end() && !backoff->second.connecting) {
+				backoff->second.nextAttempt = CCPDNPeer::Clock::now();
+			}
 		}
 
-		// Initiate connections by sending connect() to each instance (CCPDN shares controller IP)
-		int expectedPort = basePort + i;
-		int expectedSock = -1;
-#ifdef __unix__
-		expectedSock = socket(AF_INET, SOCK_STREAM, 0);
-		if (expectedSock < 0) {
-			loggy << "[CCPDN-ERROR]: Could not create CCPDN socket." << std::endl;
+		// Already connected instances are skipped inside
+		if (!connectCCPDN(i)) {
 			pauseOutput = false;
 			successFlag = false;
-			continue;
 		}
+	}
 
-		// Setup the address to connect to
+    return successFlag;
+}
+
+/// Connect to a single CCPDN instance and greet it, pushes its next reconnect attempt back on failure
+bool Controller::connectCCPDN(int index)
+{
+	// Claim the index first, so initCCPDN and the peer manager can't both connect to it
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		if (socketTopologyMap.find(index) != socketTopologyMap.end()) {
+			return true;
+		}
+
+		CCPDNBackoff& backoff = ccpdnReconnects[index];
+		if (backoff.connecting) {
+			return false;
+		}
+		backoff.connecting = true;
+	}
+
+	int hostIndex = referenceTopology->hostIndex;
+	int expectedPort = basePort + index;
+	int expectedSock = -1;
+	bool connected = false;
+#ifdef __unix__
+	expectedSock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (expectedSock < 0) {
+		loggy << "[CCPDN-ERROR]: Could not create CCPDN socket." << std::endl;
+	} else {
+		// Bound connect() and every later send(), an unreachable or stuck peer must not hold up the caller
+		struct timeval timeout;
+		timeout.tv_sec = CCPDN_SEND_TIMEOUT_MS / 1000;
+		timeout.tv_usec = (CCPDN_SEND_TIMEOUT_MS % 1000) * 1000;
+		setsockopt(expectedSock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		// Setup the address to connect to (CCPDN shares controller IP)
 		struct sockaddr_in server_address;
 		server_address.sin_family = AF_INET;
 		server_address.sin_port = htons(expectedPort);
@@ -387,41 +509,125 @@ bool Controller::initCCPDN()
 
 		// Connect to the CCPDN instance
 		if (connect(expectedSock, (struct sockaddr*)&server_address, sizeof(server_address)) < 0) {
-			loggy << "[CCPDN-ERROR]: Could not connect to CCPDN Instance." << std::endl;
 			close(expectedSock);
-			pauseOutput = false;
-			successFlag = false;
-			continue;
+			expectedSock = -1;
+		} else {
+			connected = true;
 		}
+	}
+#endif
 
-		// Display successful connection with host sockaddr ip and port
-		struct sockaddr_in local_address;
-		socklen_t address_length = sizeof(local_address);
-		if (getsockname(expectedSock, (struct sockaddr*)&local_address, &address_length) == 0) {
-			loggy << "[CCPDN]: Successfully connected to CCPDN Instance #" << std::to_string(i) << " using port " << ntohs(local_address.sin_port) << std::endl;
-		}
+	// Double the wait after every failure
+	if (!connected) {
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		CCPDNBackoff& backoff = ccpdnReconnects[index];
+		backoff.delay = (backoff.delay.count() == 0) ? std::chrono::milliseconds(CCPDN_RECONNECT_MIN_MS)
+			: std::min(backoff.delay * 2, std::chrono::milliseconds(CCPDN_RECONNECT_MAX_MS));
+		backoff.nextAttempt = CCPDNPeer::Clock::now() + backoff.delay;
+		backoff.connecting = false;
+		loggy << "[CCPDN-ERROR]: Could not connect to CCPDN Instance #" << index << ", retrying in " << backoff.delay.count() << "ms" << std::endl;
+		return false;
+	}
+
+#ifdef __unix__
+	// Display successful connection with host sockaddr ip and port
+	struct sockaddr_in local_address;
+	socklen_t address_length = sizeof(local_address);
+	if (getsockname(expectedSock, (struct sockaddr*)&local_address, &address_length) == 0) {
+		loggy << "[CCPDN]: Successfully connected to CCPDN Instance #" << std::to_string(index) << " using port " << ntohs(local_address.sin_port) << std::endl;
+	}
 #endif
-		// Update our socket-topology mapping
-		acceptedCC.push_back(expectedSock);
-		mapSocketToIndex(&acceptedCC.back(), i);
-		
-		// Update our new connection with our topology index
-		sendCCPDNMessage(expectedSock, "P" + std::to_string(hostIndex));
+
+	// Update our socket-topology mapping and start watching the socket for replies, then release the claim
+	CCPDNPeerHandle peer = addCCPDNSocket(expectedSock, true);
+	mapPeerToIndex(peer, index);
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		ccpdnReconnects.erase(index);
 	}
 
-    return successFlag;
+	// Update our new connection with our topology index and offer length-prefixed frames, binary digests, delta sync and heartbeats
+	// (NUL-terminated like every frame until the accepting instance agrees to length prefixes -- older instances only read that)
+	return sendCCPDNMessage(peer, "P" + std::to_string(hostIndex) + ":F" + std::to_string(CCPDN_FRAMING_VERSION)
+		+ ":B" + std::to_string(DIGEST_BINARY_VERSION) + ":D" + std::to_string(TOPOLOGY_DELTA_VERSION)
+		+ ":H" + std::to_string(CCPDN_HEARTBEAT_VERSION));
 }
 
-#ifdef __unix__
-void Controller::CCPDNServerThread(int port, bool *run)
+/// Keeps CCPDN connections healthy: heartbeats quiet peers, drops silent ones and reconnects lost instances
+void Controller::CCPDNPeerThread(std::atomic<bool>* run)
+{
+	loggy << "[CCPDN]: Starting peer manager..." << std::endl;
+	while (*run) {
+		CCPDNPeer::Clock::time_point now = CCPDNPeer::Clock::now();
+		std::vector<CCPDNPeerHandle> heartbeats;
+		std::vector<CCPDNPeerHandle> silent;
+		std::vector<int> reconnects;
+
+		// Decide under the lock, send and connect outside it
+		{
+			std::lock_guard<std::mutex> lock(ccpdnMutex);
+			for (const auto& entry : ccpdnPeers) {
+				const CCPDNPeerHandle& peer = entry.second;
+				if (!peer->heartbeat) {
+					continue;
+				}
+
+				if (now - peer->lastReceived > std::chrono::milliseconds(CCPDN_PEER_TIMEOUT_MS)) {
+					// Data waiting unread means the peer is alive and the reactor is busy dispatching, not that the peer went quiet
+					if (!isReadable(entry.first)) {
+						silent.push_back(peer);
+					}
+				} else if (now - peer->lastSent >= std::chrono::milliseconds(CCPDN_HEARTBEAT_MS)) {
+					heartbeats.push_back(peer);
+				}
+			}
+
+			// We connect to every instance above our own index, the ones below connect to us
+			int hostIndex = referenceTopology->hostIndex;
+			if (hostIndex >= 0 && basePort != -1) {
+				for (int i = hostIndex + 1; i < referenceTopology->getTopologyCount(); i++) {
+					if (socketTopologyMap.find(i) != socketTopologyMap.end()) {
+						continue;
+					}
+
+					auto backoff = ccpdnReconnects.find(i);
+					if (backoff == ccpdnReconnects.end() || (!backoff->second.connecting && now >= backoff->second.nextAttempt)) {
+						reconnects.push_back(i);
+					}
+				}
+			}
+		}
+
+		for (const CCPDNPeerHandle& peer : silent) {
+			loggyErr("[CCPDN-ERROR]: CCPDN instance stopped responding, dropping connection\n");
+			closePeer(peer);
+		}
+
+		for (const CCPDNPeerHandle& peer : heartbeats) {
+			if (!sendCCPDNFrame(*peer, "H")) {
+				closePeer(peer);
+			}
+		}
+
+		for (int index : reconnects) {
+			connectCCPDN(index);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(CCPDN_PEER_TICK_MS));
+	}
+}
+
+#ifdef __linux__
+/// Single reactor for all CCPDN traffic: accepts new instances and receives digests from connected ones
+void Controller::CCPDNServerThread(int port, std::atomic<bool>* run)
 {
 	/// INITIALIZATION LOGIC
-	int hostIndex = referenceTopology->hostIndex;
 	int opt = 1;
 
-	// Create socket descriptor
-	if ((sockCC = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
+	// Create socket descriptor -- non-blocking so a burst of connections can be accepted in one pass
+	if ((sockCC = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
 		loggy << "[CCPDN-ERROR]: Could not create socket." << std::endl;
+		sockCC = -1;
 		pauseOutput = false;
 		*run = false;
 		return;
@@ -453,26 +659,61 @@ void Controller::CCPDNServerThread(int port, bool *run)
 		return;
 	}
 
+	// Listen for incoming connections
+	if (listen(sockCC, referenceTopology->getTopologyCount()) < 0) {
+		loggy << "[CCPDN-ERROR]: Could not listen on port " << std::to_string(port) << std::endl;
+		close(sockCC);
+		sockCC = -1;
+		pauseOutput = false;
+		*run = false;
+		return;
+	}
+
+	// Create the reactor and register the listening socket plus any instances initCCPDN already connected
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		epollCC = epoll_create1(EPOLL_CLOEXEC);
+		if (epollCC < 0) {
+			loggy << "[CCPDN-ERROR]: Could not create CCPDN event loop." << std::endl;
+			epollCC = -1;
+			close(sockCC);
+			sockCC = -1;
+			pauseOutput = false;
+			*run = false;
+			return;
+		}
+
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.fd = sockCC;
+		epoll_ctl(epollCC, EPOLL_CTL_ADD, sockCC, &event);
+		for (auto& entry : ccpdnPeers) {
+			event.data.fd = entry.first;
+			epoll_ctl(epollCC, EPOLL_CTL_ADD, entry.first, &event);
+		}
+	}
+
 	// Start CCPDN Server Thread
 	loggy << "[CCPDN]: Starting server on port " << std::to_string(port) << std::endl;
 
 	int errorCount = 0;
+	epoll_event events[CCPDN_MAX_EVENTS];
 	/// LOOP LOGIC
 	while(*run) {
 		// Check if our errors have exceeded 5+
 		if (errorCount > 4) {
 			loggy << "[CCPDN-ERROR]: Too many failures. Stopping CCPDN service" << std::endl;
-			close(sockCC);
-			sockCC = -1;
 			pauseOutput = false;
-			*run = false;
-			return;
+			break;
 		}
 
-		// Listen for incoming connections (non-blocking call)
-		if (listen(sockCC, referenceTopology->getTopologyCount()) < 0) {
-			loggy << "[CCPDN-ERROR]: Could not listen on port " << std::to_string(port) << std::endl;
-			pauseOutput = false;
+		// Sleep until a socket is readable -- the timeout only exists to notice run being cleared
+		int activity = epoll_wait(epollCC, events, CCPDN_MAX_EVENTS, CCPDN_REACTOR_TIMEOUT_MS);
+		if (activity < 0) {
+			// Check if we just had a sys interrupt (try again in that case)
+			if (errno == EINTR) {
+				continue;
+			}
 			errorCount++;
 			continue;
 		}
@@ -482,89 +723,256 @@ void Controller::CCPDNServerThread(int port, bool *run)
 			errorCount--;
 		}
 
-		//  Accept incoming connections -- modifies the socket to be used for communication
-		socklen_t addrLen = sizeof(server_address);
-		int acceptedConnection = -1;
-		if ((acceptedConnection = accept(sockCC, (struct sockaddr*)&server_address, &addrLen)) < 0) {
+		for (int i = 0; i < activity; i++) {
+			int currentSock = events[i].data.fd;
+			if (currentSock == sockCC) {
+				acceptCCPDNConnections();
+			} else {
+				// Hangups and errors are read too, recv() reports them and closes the socket
+				recvProcessCCPDN(currentSock);
+			}
+		}
+	}
+
+	// Server and socket closure incase we somehow exit loop
+	stopCCPDNServer();
+	*run = false;
+}
 
+void Controller::acceptCCPDNConnections()
+{
+	// Drain the accept queue -- the listening socket is non-blocking, EAGAIN means we're done
+	while (true) {
+		struct sockaddr_in client_address;
+		socklen_t addrLen = sizeof(client_address);
+		int acceptedConnection = accept4(sockCC, (struct sockaddr*)&client_address, &addrLen, SOCK_CLOEXEC);
+		if (acceptedConnection < 0) {
 			// Check if we just had a sys interrupt (try again in that case)
 			if (errno == EINTR) {
 				continue;
 			}
-
-			loggy << "[CCPDN-ERROR]: Could not accept incoming connection." << std::endl;
-			pauseOutput = false;
-			errorCount++;
-			continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				loggy << "[CCPDN-ERROR]: Could not accept incoming connection." << std::endl;
+				pauseOutput = false;
+			}
+			return;
 		}
 
-		// Add new connection to list of our connections
-		acceptedCC.push_back(acceptedConnection);
+		// Same bound on sends as the connections we make, a peer that stops reading can't stall us
+		struct timeval timeout;
+		timeout.tv_sec = CCPDN_SEND_TIMEOUT_MS / 1000;
+		timeout.tv_usec = (CCPDN_SEND_TIMEOUT_MS % 1000) * 1000;
+		setsockopt(acceptedConnection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		// Add new connection to list of our connections, watched from the next epoll_wait() on
+		addCCPDNSocket(acceptedConnection, false);
 		// Print our shiny new connection :)
-		std::string clientIP = inet_ntoa(server_address.sin_addr);
-		int clientPort = ntohs(server_address.sin_port);
+		std::string clientIP = inet_ntoa(client_address.sin_addr);
+		int clientPort = ntohs(client_address.sin_port);
 		loggy << "[CCPDN]: Accepted new connection from " << clientIP << ":" << clientPort << std::endl;
 	}
+}
+#endif
 
-	// Server and socket closure incase we somehow exit loop
-	if (sockCC != -1) {
-		close(sockCC);
-		sockCC = -1;
+CCPDNPeerHandle Controller::addCCPDNSocket(int socket, bool outbound)
+{
+	CCPDNPeerHandle peer = std::make_shared<CCPDNPeer>();
+	peer->socket = socket;
+	peer->outbound = outbound;
+
+	std::lock_guard<std::mutex> lock(ccpdnMutex);
+	ccpdnPeers[socket] = peer;
+
+#ifdef __linux__
+	// Register with the reactor right away -- if it isn't running yet it picks ccpdnPeers up when it starts
+	if (epollCC != -1) {
+		epoll_event event;
+		event.events = EPOLLIN;
+		event.data.fd = socket;
+		epoll_ctl(epollCC, EPOLL_CTL_ADD, socket, &event);
 	}
-	stopCCPDNServer();
-	*run = false;
+#endif
+	return peer;
 }
+
+bool Controller::isReadable(int socket)
+{
+#ifdef __unix__
+	struct pollfd request;
+	request.fd = socket;
+	request.events = POLLIN;
+	request.revents = 0;
+	return poll(&request, 1, 0) > 0 && (request.revents & POLLIN);
+#else
+	return false;
 #endif
+}
+
+void Controller::enablePeerOption(const CCPDNPeerHandle& peer, bool CCPDNPeer::* option)
+{
+	std::lock_guard<std::mutex> lock(ccpdnMutex);
+	(*peer).*option = true;
+}
 
 bool Controller::stopCCPDNServer()
 {
-	// Close all connected CCPDN sockets
-	if (sockCC != -1) {
-	#ifdef __unix__
-		close(sockCC);
-		sockCC = -1;
-	#endif
+	std::unordered_map<int, CCPDNPeerHandle> peers;
+	std::vector<int> lostIndexes;
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+
+		// Close the listening socket
+		if (sockCC != -1) {
+		#ifdef __unix__
+			close(sockCC);
+			sockCC = -1;
+		#endif
+		}
+
+		peers.swap(ccpdnPeers);
+		ccpdnReconnects.clear();
+		for (const auto& entry : socketTopologyMap) {
+			lostIndexes.push_back(entry.first);
+		}
+		socketTopologyMap.clear();
+		peerTopologyVersions.clear();
+
+		#ifdef __linux__
+		if (epollCC != -1) {
+			close(epollCC);
+			epollCC = -1;
+		}
+		#endif
 	}
 
-	for (int i = 0; i < acceptedCC.size(); i++) {
+	// Close all connected CCPDN sockets, each once any send in progress on it gives up
+	for (auto& entry : peers) {
 	#ifdef __unix__
-		close(acceptedCC[i]);
-		acceptedCC[i] = -1;
+		shutdown(entry.first, SHUT_RDWR);
+		std::lock_guard<std::mutex> sendLock(entry.second->sendMutex);
+		entry.second->closed = true;
+		close(entry.first);
 	#endif
 	}
 
+	// Nothing outstanding can be answered anymore
+	for (int index : lostIndexes) {
+		pendingVerifications.completeAll(index, false);
+		pendingFlowLists.completeAll(index, std::vector<Flow>());
+	}
+
     return true;
 }
 
-void Controller::closeAcceptedSocket(int socket)
+void Controller::closePeer(const CCPDNPeerHandle& peer)
 {
 	#ifdef __unix__
-		// Find the index that has the socket in acceptedCC
-		auto it = std::find(acceptedCC.begin(), acceptedCC.end(), socket);
-		if (it != acceptedCC.end()) {
-			acceptedCC.erase(it);
+		if (peer == nullptr) {
+			return;
+		}
+		int socket = peer->socket;
+		std::vector<int> lostIndexes;
+
+		{
+			std::lock_guard<std::mutex> lock(ccpdnMutex);
+
+			// The reactor, the peer manager and senders can all notice a dead peer, only the first one closes it
+			auto it = ccpdnPeers.find(socket);
+			if (it == ccpdnPeers.end() || it->second != peer) {
+				return;
+			}
+
+			// Drops any partial frame and whatever the peer negotiated along with it
+			ccpdnPeers.erase(it);
+
+			// Forget which instance it belonged to (and what it knew), instances we connected to get reconnected
+			for (auto mapIt = socketTopologyMap.begin(); mapIt != socketTopologyMap.end();) {
+				if (mapIt->second == peer) {
+					lostIndexes.push_back(mapIt->first);
+					peerTopologyVersions.erase(mapIt->first);
+					if (peer->outbound) {
+						CCPDNBackoff& backoff = ccpdnReconnects[mapIt->first];
+						backoff.delay = std::chrono::milliseconds(CCPDN_RECONNECT_MIN_MS);
+						backoff.nextAttempt = CCPDNPeer::Clock::now() + backoff.delay;
+					}
+					mapIt = socketTopologyMap.erase(mapIt);
+				} else {
+					mapIt++;
+				}
+			}
+
+		#ifdef __linux__
+			if (epollCC != -1) {
+				epoll_ctl(epollCC, EPOLL_CTL_DEL, socket, nullptr);
+			}
+		#endif
+		}
+
+		// Wake any send blocked on the socket, then close it once nobody is writing -- the number can be reused after this
+		shutdown(socket, SHUT_RDWR);
+		{
+			std::lock_guard<std::mutex> sendLock(peer->sendMutex);
+			peer->closed = true;
+			close(socket); // Close the socket
+		}
+
+		// No reply can come back over this connection, fail its outstanding requests now rather than at their timeouts
+		for (int index : lostIndexes) {
+			pendingVerifications.completeAll(index, false);
+			pendingFlowLists.completeAll(index, std::vector<Flow>());
 		}
-		close(socket); // Close the socket
 	#endif
 }
 
+bool Controller::isLocalVerification(Flow f)
+{
+	// Only flow mods whose switch and next hop are both in the host topology (Case 0 of parseFlow)
+	if (!f.hasSwitch() || !f.hasNextHop() || !f.isMod()) {
+		return false;
+	}
+
+	// Ignored flows are left to parseFlow so it can clear them from the ignore list
+	if (ignoreFlows.contains(f)) {
+		return false;
+	}
+
+	bool isBothLocal = referenceTopology->isLocal(f.getSwitchIP(), true) && referenceTopology->isLocal(f.getNextHopIP(), true);
+	return isBothLocal && referenceTopology->isLinked(f.getSwitchIP(), f.getNextHopIP());
+}
+
+void Controller::verifyFlowBatch(std::vector<Flow> flows)
+{
+	loggy << "[CCPDN]: Running verification on " << flows.size() << " flow rule(s)" << std::endl;
+
+	// Run verification on every flow rule in a single VeriFlow exchange
+	std::vector<bool> results = performBatchVerification(flows);
+
+	for (size_t i = 0; i < flows.size(); i++) {
+		if (!results[i]) {
+			// Verification unsuccessful -- remove from openflow table
+			loggy << "[CCPDN]: Verification failed for flow rule: " << flows[i].flowToStr(false) << std::endl;
+			modifyFlowTableWithoutVerification(flows[i], false);
+		}
+	}
+	pauseOutput = false;
+}
+
 void Controller::parseFlow(Flow f)
 {
 	// Error checking:
-	if (f.getSwitchIP() == "" || f.getNextHopIP() == "") {
+	if (!f.hasSwitch() || !f.hasNextHop()) {
 		return;
 	}
 
 	// Make sure our flow isn't in the ignoreFlow list -- if it is, remove it and leave this method
-	if (std::find(ignoreFlows.begin(), ignoreFlows.end(), f) != ignoreFlows.end()) {
-		ignoreFlows.erase(std::remove(ignoreFlows.begin(), ignoreFlows.end(), f), ignoreFlows.end());
+	if (ignoreFlows.erase(f)) {
 		return;
 	}
 
 	// Ensure we have a valid flow by checking if at least one of them are within the local topology
 	bool isSrcLocal = referenceTopology->isLocal(f.getSwitchIP(), f.isMod());
 	bool isHopLocal = referenceTopology->isLocal(f.getNextHopIP(), f.isMod());
-	bool isValid = (isSrcLocal || isHopLocal) && referenceTopology->getNodeByIP(f.getSwitchIP()).isLinkedTo(f.getNextHopIP());
+	bool isValid = (isSrcLocal || isHopLocal) && referenceTopology->isLinked(f.getSwitchIP(), f.getNextHopIP());
 	bool isBothLocal = isSrcLocal && isHopLocal;
 
 	// Invalid flow verification -- we don't handle other topologies verification, only inter-topology
@@ -582,8 +990,7 @@ void Controller::parseFlow(Flow f)
 	if (f.isMod() && isBothLocal) {
 		loggy << "[CCPDN]: Running verification on flow rule: " << f.flowToStr(false) << std::endl;
 		// Run verification on the flow rule
-		recvSharedFlag = true;
-		if (!performVerification(false, f)) {
+		if (!performVerification(f)) {
 			// Verification unsuccessful -- remove from openflow table
 			modifyFlowTableWithoutVerification(f, false);
 		}
@@ -595,7 +1002,6 @@ void Controller::parseFlow(Flow f)
 	// Flow rule (target IP and forward hops) are NOT ALL within host topology
 	// Action: run inter-topology verification method on flow rule
 	if (f.isMod() && !isBothLocal) {
-		forceStopShared = false;
 		loggy << "[CCPDN]: Running inter-topology verification on flow rule: " << f.flowToStr(false) << std::endl;
 		// remapVerify will handle adding the flow to the tables
         remapVerify(f);
@@ -604,34 +1010,36 @@ void Controller::parseFlow(Flow f)
     }
 }
 
-bool Controller::parsePacket(std::vector<uint8_t>& packet, bool xidCheck) {
+bool Controller::parsePacket(std::span<const uint8_t> packet, bool xidCheck) {
 
 	// Ensure we have a valid packet
-	if (packet.empty() || packet.size() < 0) {
+	if (packet.empty()) {
 		return false;
 	}
 
 	size_t offset = 0;
 #ifdef __unix
-	while (offset <= packet.size()) {
+	while (offset < packet.size()) {
 
-		// Ensure we have at least a header?
-		if (packet.size() - offset < sizeof(ofp_header)) {
+		// View the next message in place -- rejects truncated headers and lengths that run past the buffer
+		OpenFlowView msg(packet.subspan(offset));
+		if (!msg.valid()) {
 			return false;
 		}
 
-		// Parse the header
-		ofp_header* header = reinterpret_cast<ofp_header*>(packet.data() + offset);
-		uint8_t header_type = header->type;
-		uint16_t msg_length = ntohs(header->length);
-		uint32_t host_endian_XID = ntohl(header->xid);
+		uint8_t header_type = msg.type();
+		uint32_t host_endian_XID = msg.xid();
+
+		// Replies are encoded into this thread's scratch buffer, so answering handshakes allocates nothing
+		std::span<unsigned char> reply = OpenFlowMessage::scratch();
 
-		// Drop packet if we are not intended to process it based on XID
+		// Skip messages we are not intended to process based on XID -- the rest of the run may still be ours
 		int hostTopologyLower = referenceTopology->hostIndex * 1000;
 		int hostTopologyUpper = hostTopologyLower + 999;
 		if (((static_cast<int>(host_endian_XID) < hostTopologyLower) && xidCheck)
 		|| ((static_cast<int>(host_endian_XID) > hostTopologyUpper) && xidCheck)) {
-			return false;
+			offset += msg.length();
+			continue;
 		}
 
 		// Based on header type, process our packet
@@ -639,26 +1047,28 @@ bool Controller::parsePacket(std::vector<uint8_t>& packet, bool xidCheck) {
 			case OFPT_HELLO: {
 				// Confirms connection was established
 				loggy << "[CCPDN]: Received Hello." << std::endl;
-				sendOpenFlowMessage(OpenFlowMessage::createHello(host_endian_XID));
+				sendOpenFlowMessage(reply.first(OpenFlowMessage::encodeHello(reply, host_endian_XID)));
 				break;
 			}
 			case OFPT_FEATURES_REQUEST: {
 				// Send a features reply -- required for OF protocol
 				loggy << "[CCPDN]: Received Features_Request." << std::endl;
-				sendOpenFlowMessage(OpenFlowMessage::createFeaturesReply(host_endian_XID));
+				sendOpenFlowMessage(reply.first(OpenFlowMessage::encodeFeaturesReply(reply, host_endian_XID)));
 				break;
 			}
 			case OFPT_STATS_REQUEST: {
 				// Send a stats reply -- required for OF protocol
-				ofp_stats_request* request = reinterpret_cast<ofp_stats_request*>(packet.data() + offset);
+				const ofp_stats_request* request = msg.statsRequest();
+				if (request == nullptr) {
+					break;
+				}
 				uint16_t request_type = ntohs(request->type);
-				uint16_t request_flags = ntohs(request->flags);
 
 				// determine type of response
 				switch (request_type) {
 					case OFPST_DESC: {
 						loggy << "[CCPDN]: Received Desc Stats Request." << std::endl;
-						sendOpenFlowMessage(OpenFlowMessage::createDescStatsReply(host_endian_XID));
+						sendOpenFlowMessage(reply.first(OpenFlowMessage::encodeDescStatsReply(reply, host_endian_XID)));
 						break;
 					}
 				}
@@ -667,30 +1077,26 @@ bool Controller::parsePacket(std::vector<uint8_t>& packet, bool xidCheck) {
 			case OFPT_BARRIER_REQUEST: {
 				// Send a barrier reply -- required for OF protocol
 				loggy << "[CCPDN]: Received Barrier_Request." << std::endl;
-				sendOpenFlowMessage(OpenFlowMessage::createBarrierReply(host_endian_XID));
+				sendOpenFlowMessage(reply.first(OpenFlowMessage::encodeBarrierReply(reply, host_endian_XID)));
 				pauseOutput = false;
 				break;
 			}
 			case OFPT_STATS_REPLY: {
 				// Handle stats reply -- used for listing flows. Set fHFlag to true for list-flows
 				loggy << "[CCPDN]: Received Stats_Reply." << std::endl;
-				ofp_stats_reply* reply = reinterpret_cast<ofp_stats_reply*>(packet.data() + offset);
-
-				handleStatsReply(reply);
+				handleStatsReply(msg);
 				break;
 			}
 			case OFPT_FLOW_MOD: {
 				// Handle flow modification -- used for verification
 				loggy << "[CCPDN]: Received Flow_Mod." << std::endl;
-				ofp_flow_mod* mod = reinterpret_cast<ofp_flow_mod*>(packet.data() + offset);
-				handleFlowMod(mod);
+				handleFlowMod(msg);
 				break;
 			}
 			case OFPT_FLOW_REMOVED: {
 				// Handle flow removal -- used for verification
 				loggy << "[CCPDN]: Received Flow_Removed." << std::endl;
-				ofp_flow_removed* removed = reinterpret_cast<ofp_flow_removed*>(packet.data() + offset);
-				handleFlowRemoved(removed);
+				handleFlowRemoved(msg);
 				break;
 			}
 			case OFPT_SET_CONFIG: {
@@ -704,7 +1110,7 @@ bool Controller::parsePacket(std::vector<uint8_t>& packet, bool xidCheck) {
 		}
 
 		// Move to next message
-		offset += msg_length;
+		offset += msg.length();
 	}
 #endif
 
@@ -743,60 +1149,69 @@ std::string exec(const std::string& command, std::string match) {
 
 bool Controller::requestVerification(int destinationIndex, Flow f)
 {
-	/// WARNING: This method should not be ran concurrently with itself, only one instance of this method should be running at a time
+	uint32_t requestID = 0;
+	std::future<bool> result = requestVerificationAsync(destinationIndex, f, &requestID);
+
+	// Wait for response from destination topology, or timeout of 0.9 seconds
+	if (result.wait_for(std::chrono::milliseconds(CCPDN_VERIFY_TIMEOUT_MS)) != std::future_status::ready) {
+		pendingVerifications.cancel(requestID);
+		loggyErr("[CCPDN-ERROR]: Timeout waiting for verification result from topology " + std::to_string(destinationIndex) + "\n");
+		return false;
+	}
+
+	return result.get();
+}
+
+std::future<bool> Controller::requestVerificationAsync(int destinationIndex, Flow f, uint32_t* requestID)
+{
+	// Caller can cancel with this ID if it stops waiting
+	if (requestID != nullptr) {
+		*requestID = 0;
+	}
 
 	// Verify destination index exists within current topology, and is not the host index
 	if ((destinationIndex < 0 || destinationIndex >= referenceTopology->getTopologyCount()) || (destinationIndex == referenceTopology->hostIndex)) {
-		return false;
+		std::promise<bool> invalid;
+		invalid.set_value(false);
+		return invalid.get_future();
 	}
 
-	// Don't allow recvProcessCCPDN() to clear the CCPND_FLOW_SUCCESS and CCPDN_FLOW_FAIL vectors
-	ALLOW_CCPDN_RECV = true;
+	// Register the request first so a fast reply can't arrive before we're listening for it
+	std::future<bool> result;
+	uint32_t id = pendingVerifications.open(destinationIndex, result);
+	if (requestID != nullptr) {
+		*requestID = id;
+	}
 
 	// Create digest message, send for verification
 	Digest verificationMessage(false, false, true, referenceTopology->hostIndex, destinationIndex, "");
 	verificationMessage.appendFlow(f);
+	verificationMessage.setRequestID(id);
 
-	sendCCPDNMessage(*getSocketFromIndex(destinationIndex), verificationMessage.toJson());
-
-	// Wait for response from destination topology, or timeout of 0.9 seconds
-	auto start = std::chrono::steady_clock::now();
-	while (CCPDN_FLOW_SUCCESS.size() == 0 || CCPDN_FLOW_FAIL.size() == 0) {
-		auto now = std::chrono::steady_clock::now();
-		if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() > 900) {
-			break;
-		}
+	if (!sendCCPDNDigest(getPeer(destinationIndex), verificationMessage)) {
+		pendingVerifications.complete(id, false);
 	}
 
-	// Based on the responding vector, determine if we have a success or failure
-	if (CCPDN_FLOW_SUCCESS.size() > 0) {
-		Flow returnFlow = CCPDN_FLOW_SUCCESS.front();
-		CCPDN_FLOW_SUCCESS.clear();
-		return true;
-	} else if (CCPDN_FLOW_FAIL.size() > 0) {
-		Flow returnFlow = CCPDN_FLOW_FAIL.front();
-		CCPDN_FLOW_FAIL.clear();
-		return false;
-	}
-
-	// Timeout occurred
-	ALLOW_CCPDN_RECV = false;
-	return false;
+	return result;
 }
 
-bool Controller::performVerification(bool externalRequest, Flow f)
+bool Controller::performVerification(Flow f)
 {
 	// Craft the packet
 	std::string packet = "[CCPDN] FLOW ";
 	packet += f.flowToStr(false);
 
-	// Send the packet, wait for response
-	sendVeriFlowMessage(packet);
-	recvVeriFlowMessages();
-	rstVeriFlowFlag();
+	// Send the packet, wait for response -- the exchange is ours alone until the reply is read
+	std::string response;
+	{
+		std::lock_guard<std::mutex> lock(veriflowMutex);
+		sendVeriFlowMessage(packet);
+		recvVeriFlowMessages();
+		rstVeriFlowFlag();
+		response = readBuffer(vfBuffer);
+	}
 
 	// Decode response
-	std::string response = readBuffer(vfBuffer);
 
 	if (response == "[VERIFLOW] Success") {
 		return true;
@@ -805,6 +1220,80 @@ bool Controller::performVerification(bool externalRequest, Flow f)
 	return false;
 }
 
+std::vector<bool> Controller::performBatchVerification(std::vector<Flow> flows)
+{
+	// Default every flow to failed -- anything VeriFlow doesn't answer for gets removed
+	std::vector<bool> results(flows.size(), false);
+	if (flows.empty()) {
+		return results;
+	}
+
+	// Craft the packet -- FORMAT: [CCPDN] BATCH 0=A#192.168.0.0-0.0.0.0/0-192.168.0.1;1=R#...
+	// Flow IDs are the index of the flow within this batch
+	std::string packet = "[CCPDN] BATCH ";
+	for (size_t i = 0; i < flows.size(); i++) {
+		if (i > 0) {
+			packet += ";";
+		}
+		packet += std::to_string(i) + "=" + flows[i].flowToStr(false);
+	}
+
+#ifdef __unix__
+	// Send the whole batch in one exchange, and read until the newline terminating the response -- it can span several recv() calls
+	std::string response;
+	{
+		std::lock_guard<std::mutex> lock(veriflowMutex);
+		sendVeriFlowMessage(packet);
+
+		char buffer[1024];
+		while (response.find('\n') == std::string::npos) {
+			ssize_t bytes_received = recv(sockvf, buffer, sizeof(buffer), 0);
+			if (bytes_received <= 0) {
+				loggyErr("[CCPDN-ERROR]: Lost connection to VeriFlow while waiting for batch response\n");
+				return results;
+			}
+			response.append(buffer, bytes_received);
+		}
+	}
+	response = response.substr(0, response.find('\n'));
+	loggyMsg("[CCPDN]: Message from VeriFlow\n");
+	loggyMsg(response + "\n");
+
+	// Decode response -- FORMAT: [VERIFLOW] BATCH 0=S;1=F
+	const std::string prefix = "[VERIFLOW] BATCH ";
+	if (response.compare(0, prefix.size(), prefix) != 0) {
+		loggyErr("[CCPDN-ERROR]: Malformed batch response from VeriFlow\n");
+		return results;
+	}
+
+	size_t start = prefix.size();
+	while (start < response.size()) {
+		size_t end = response.find(';', start);
+		if (end == std::string::npos) {
+			end = response.size();
+		}
+
+		// Each entry is [id]=[S/F]
+		std::string entry = response.substr(start, end - start);
+		size_t split = entry.find('=');
+		if (split != std::string::npos && split + 1 < entry.size()) {
+			try {
+				size_t id = std::stoul(entry.substr(0, split));
+				if (id < results.size()) {
+					results[id] = (entry[split + 1] == 'S');
+				}
+			} catch (const std::exception& e) {
+				loggyErr("[CCPDN-ERROR]: Skipping malformed batch entry: " + entry + "\n");
+			}
+		}
+
+		start = end + 1;
+	}
+#endif
+
+	return results;
+}
+
 bool Controller::undoVerification(Flow f, int topologyIndex)
 {
 	// Verify topology index is within the topology range, or is -1
@@ -817,7 +1306,7 @@ bool Controller::undoVerification(Flow f, int topologyIndex)
 
 	// Only undoes verification for flows that are already verified, and only for veriflow
 	if (topologyIndex == -1) {
-		result = performVerification(false, undoFlow);
+		result = performVerification(undoFlow);
 	} else {
 		result = requestVerification(topologyIndex, undoFlow);
 	}
@@ -833,10 +1322,10 @@ bool Controller::modifyFlowTableWithoutVerification(Flow f, bool success)
 	bool result = true;
 
 	// Make sure DPID and output port are valid
-	std::string dpid = std::to_string(getDPID(f.getSwitchIP()));
-	std::string outputPort = std::to_string(getOutputPort(f.getSwitchIP(), f.getNextHopIP()));
+	uint64_t dpid = getDPID(f.getSwitchIP());
+	int outputPort = getOutputPort(f.getSwitchIP(), f.getNextHopIP());
 
-	if (dpid == "-1" || outputPort == "-1") {
+	if (dpid == DPID_NONE || outputPort == -1) {
 		loggy << "[CCPDN-ERROR]: Attempted to add flow but couldn't resolve DPIDS: " << f.flowToStr(false) << std::endl;
 		return false;
 	}
@@ -851,29 +1340,29 @@ bool Controller::modifyFlowTableWithoutVerification(Flow f, bool success)
 	if (f.actionType() && !success) {            
 		loggy << "[CCPDN]: Removing flow " << f.flowToStr(false) << " from flow table due to failed verification" << std::endl;
 		// Remove flow from table if this was an add (pretty sure all of them will be add)
-		result = sendFlowHandlerMessage("removeflow-" + f.flowToStr(true) + "-" + std::to_string(genXID));
+		result = sendFlowInstall(f, false, genXID);
 	} 
 	// Remove flow successful verification
 	else if (!f.actionType() && success) {
 		loggy << "[CCPDN]: Removing flow " << f.flowToStr(false) << " from flow table due to successful verification" << std::endl;
 		// Remove flow from table if this was an add (pretty sure all of them will be add)
-		result = sendFlowHandlerMessage("removeflow-" + f.flowToStr(true) + "-" + std::to_string(genXID));
+		result = sendFlowInstall(f, false, genXID);
 	}
 	// Remove flow unsuccessful verification
 	else if (f.actionType() && !success) {
 		loggy << "[CCPDN]: Adding flow " << f.flowToStr(false) << " to flow table due to failed verification" << std::endl;
 		// Add flow to table if this was a delete
-		result = sendFlowHandlerMessage("addflow-" + f.flowToStr(true) + "-" + std::to_string(genXID));
+		result = sendFlowInstall(f, true, genXID);
 	}
 	// Add flow successful verification
 	else if (f.actionType() && success) {
 		loggy << "[CCPDN]: Adding flow " << f.flowToStr(false) << " to flow table due to successful verification" << std::endl;
 		// Re-add the flow if this was a delete
-		result = sendFlowHandlerMessage("addflow-" + f.flowToStr(true) + "-" + std::to_string(genXID));
+		result = sendFlowInstall(f, true, genXID);
 	}
 
 	// Add flow to ignore table, so the flow handler doesn't try to verify it again
-	ignoreFlows.push_back(f);
+	ignoreFlows.insert(f);
 
 	return result;
 }
@@ -881,10 +1370,10 @@ bool Controller::modifyFlowTableWithoutVerification(Flow f, bool success)
 bool Controller::remapVerify(Flow newFlow)
 {
 	// Get IP to local domain node
-	Node* localNode = referenceTopology->getNodeReference(referenceTopology->getNodeByIP(newFlow.getSwitchIP()));
-	Node* remoteNode = referenceTopology->getNodeReference(referenceTopology->getNodeByIP(newFlow.getNextHopIP()));
-	Node domainNode = getBestDomainNode(localNode->getTopologyID(), remoteNode->getTopologyID());
-	std::string domainNodeIP = domainNode.getIP();
+	int localIndex = referenceTopology->getNodeView(newFlow.getSwitchIP()).getTopologyID();
+	int remoteNodeIndex = referenceTopology->getNodeView(newFlow.getNextHopIP()).getTopologyID();
+	const Node* domainNode = getBestDomainNode(localIndex, remoteNodeIndex);
+	std::string domainNodeIP = (domainNode != nullptr) ? domainNode->getIP() : "-1";
 
 	// Remap the flow into two separate flows, one for each topology -- use domain node IP to remap
 	Flow local = translateFlows({newFlow}, newFlow.getNextHopIP(), domainNodeIP).at(0)[0];
@@ -896,11 +1385,11 @@ bool Controller::remapVerify(Flow newFlow)
 	// Make sure we aren't linking local->remote when we already have remote->local, or vice versa
 
 	// Handle duplicates in flow remapping -- meaning this flow involves the domain node itself
-	bool localDuplicate = (local.getSwitchIP() == local.getNextHopIP());
-	bool remoteDuplicate = (remote.getSwitchIP() == remote.getNextHopIP());
+	bool localDuplicate = local.isSelfLoop();
+	bool remoteDuplicate = remote.isSelfLoop();
 
 	// Make sure the local flow can link to the given domainNodeIP (and isn't a domain node at the same time)
-	if (!referenceTopology->getNodeByIP(local.getSwitchIP()).isLinkedTo(domainNodeIP) && !referenceTopology->getNodeByIP(local.getSwitchIP()).isDomainNode()) {
+	if (!referenceTopology->isLinked(local.getSwitchIP(), domainNodeIP) && !referenceTopology->getNodeView(local.getSwitchIP()).isDomainNode()) {
 		// If our current flow cannot remap to domain node, first find a path to a node connected to the domain node
 		// For the final project, we won't do this -- leave this problem for future work
 		// Ideally we could use BFS or something similar to find the best path -- make sure we mention this in presentation
@@ -908,33 +1397,53 @@ bool Controller::remapVerify(Flow newFlow)
 		return false;
 	}
 
-	// Verify the local flow -- if good, continue
-	if (!localDuplicate) {
-		loggy << "[CCPDN]: Verifying local flow for inter-topology: " << local.flowToStr(false) << std::endl;
-		if (!performVerification(false, local)) {
-			return false;
-		}
-	}
-
-	int remoteIndex = referenceTopology->getNodeByIP(remote.getSwitchIP()).getTopologyID();
+	int remoteIndex = referenceTopology->getNodeView(remote.getSwitchIP()).getTopologyID();
 	
 	if (remoteIndex == 0) {
 		loggy << "Index couldn't properly adjust" << std::endl;
 		remoteIndex = 1;
 	}
 
-	// Verify the remote flow -- if good, the verification is successful, otherwise undo the local verification
+	// Send the remote request first, so the remote topology verifies while we verify locally
+	std::future<bool> remoteResult;
+	uint32_t remoteRequestID = 0;
 	if (!remoteDuplicate) {
 		loggy << "[CCPDN]: Verifying remote flow for inter-topology: " << remote.flowToStr(false) << std::endl;
-		if (!requestVerification(remoteIndex, remote)) {
-			if (!localDuplicate) {
-				loggy << "[CCPDN]: Verification failed for remote flow, undoing previous flow: " << local.flowToStr(false) << std::endl;
-				undoVerification(local, -1);
-			}
-			return false;
+		remoteResult = requestVerificationAsync(remoteIndex, remote, &remoteRequestID);
+	}
+
+	// Verify the local flow
+	bool localSuccess = true;
+	if (!localDuplicate) {
+		loggy << "[CCPDN]: Verifying local flow for inter-topology: " << local.flowToStr(false) << std::endl;
+		localSuccess = performVerification(local);
+	}
+
+	// Collect the remote result
+	bool remoteSuccess = true;
+	if (!remoteDuplicate) {
+		if (remoteResult.wait_for(std::chrono::milliseconds(CCPDN_VERIFY_TIMEOUT_MS)) == std::future_status::ready) {
+			remoteSuccess = remoteResult.get();
+		} else {
+			loggyErr("[CCPDN-ERROR]: Timeout waiting for verification result from topology " + std::to_string(remoteIndex) + "\n");
+			pendingVerifications.cancel(remoteRequestID);
+			remoteSuccess = false;
 		}
 	}
 
+	// Both halves must pass -- otherwise undo whichever half was verified
+	if (!localSuccess || !remoteSuccess) {
+		if (!localDuplicate && localSuccess) {
+			loggy << "[CCPDN]: Verification failed for remote flow, undoing previous flow: " << local.flowToStr(false) << std::endl;
+			undoVerification(local, -1);
+		}
+		if (!remoteDuplicate && remoteSuccess) {
+			loggy << "[CCPDN]: Verification failed for local flow, undoing remote flow: " << remote.flowToStr(false) << std::endl;
+			undoVerification(remote, remoteIndex);
+		}
+		return false;
+	}
+
 	// Verification successful at this point -- add/remove both from the flow table
 	loggy << "[CCPDN]: Inter-topology verification successful for flow remapping!" << std::endl;
 	if (!localDuplicate) {
@@ -952,19 +1461,19 @@ std::vector<std::string> Controller::getLinkPathToNode(std::string srcIP, std::s
 	std::vector<std::string> path;
 
 	// Get all links associated with source node
-	std::vector<std::string> srcLinks = referenceTopology->getNodeByIP(srcIP).getLinks();
-	std::vector<std::string> dstLinks = referenceTopology->getNodeByIP(dstIP).getLinks();
+	std::vector<std::string> srcLinks = referenceTopology->getNodeView(srcIP).getLinks();
+	std::vector<std::string> dstLinks = referenceTopology->getNodeView(dstIP).getLinks();
 
 	// Get the node copies of given links
 	std::vector<Node> srcNodes;
 	std::vector<Node> dstNodes;
-	for (std::string link : srcLinks) {
+	for (const std::string& link : srcLinks) {
 		Node n = referenceTopology->getNodeByIP(link);
 		if (n.isSwitch()) {
 			srcNodes.push_back(n);
 		}
 	}
-	for (std::string link : dstLinks) {
+	for (const std::string& link : dstLinks) {
 		Node n = referenceTopology->getNodeByIP(link);
 		if (n.isSwitch()) {
 			dstNodes.push_back(n);
@@ -982,50 +1491,67 @@ std::vector<Flow> Controller::getRelatedFlows(std::string IP)
 {
 	std::vector<Flow> returnList = retrieveFlows(IP, false);
 
+	// Copied since the remote requests below block, and the topology can be updated meanwhile
 	Node n = referenceTopology->getNodeByIP(IP);
+	int topologyID = n.getTopologyID();
 	std::vector<std::string> IPList = n.getLinks();
 
-	for (std::string ip : IPList) {
+	// Flows are matched against the target switch by address
+	uint32_t address = 0;
+	Flow::parseIPv4(IP, address);
+
+	// Outstanding flow list requests to other topologies
+	std::vector<std::pair<uint32_t, std::future<std::vector<Flow>>>> remoteRequests;
+
+	for (const std::string& ip : IPList) {
 		Node m = referenceTopology->getNodeByIP(ip);
-		if (m.isSwitch() && m.isMatchingDomain(n)) {
+		if (m.isSwitch() && m.getTopologyID() == topologyID) {
 			std::vector<Flow> flows = retrieveFlows(ip, false);
-			for (Flow f : flows) {
-				if (f.getNextHopIP() == IP) {
+			for (const Flow& f : flows) {
+				if (f.getNextHopAddress() == address) {
 					returnList.push_back(f);
 				}
 			}
 		} else if (m.isSwitch()) {
-			// Send a digest to the target topology requesting this info
-			Digest request(false, false, false, referenceTopology->hostIndex, m.getTopologyID(), m.getIP());
+			CCPDNPeerHandle peer = getPeer(m.getTopologyID());
+			if (peer == nullptr) {
+				continue;
+			}
 
-			// Clear any previous hanging responses
-			CCPDN_FLOW_RESPONSE.clear();
+			// Send a digest to the target topology requesting this info -- all requests go out before we wait on any
+			std::future<std::vector<Flow>> response;
+			uint32_t requestID = pendingFlowLists.open(m.getTopologyID(), response);
+			Digest request(false, false, false, referenceTopology->hostIndex, m.getTopologyID(), m.getIP());
+			request.setRequestID(requestID);
+			if (!sendCCPDNDigest(peer, request)) {
+				pendingFlowLists.cancel(requestID);
+				continue;
+			}
 
-			sendCCPDNMessage(*getSocketFromIndex(m.getTopologyID()), request.toJson());
+			remoteRequests.emplace_back(requestID, std::move(response));
+		}
+	}
 
-			// Wait until CCPDN_FLOW_RESPONSE is no longer empty, or if a timeout of 500ms has passed
-			auto start = std::chrono::steady_clock::now();
-			while (CCPDN_FLOW_RESPONSE.size() == 0) {
-				auto now = std::chrono::steady_clock::now();
-				if (std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count() > 500) {
-					break;
-				}
-			}
+	// Wait for every response until a shared deadline of 500ms
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(CCPDN_FLOW_LIST_TIMEOUT_MS);
+	for (auto& request : remoteRequests) {
+		if (request.second.wait_until(deadline) != std::future_status::ready) {
+			pendingFlowLists.cancel(request.first);
+			loggyErr("[CCPDN-ERROR]: Timeout waiting for flow list from remote topology\n");
+			continue;
+		}
 
-			// Check if any of the flows in this list contain a nextHopIP leading to the target switch
-			for (Flow f : CCPDN_FLOW_RESPONSE) {
-				if (f.getNextHopIP() == IP) {
-					returnList.push_back(f);
-				}
+		// Check if any of the flows in this list contain a nextHopIP leading to the target switch
+		for (const Flow& f : request.second.get()) {
+			if (f.getNextHopAddress() == address) {
+				returnList.push_back(f);
 			}
-
-			// Clear CCPDN_FLOW_RESPONSE
-			CCPDN_FLOW_RESPONSE.clear();
 		}
 	}
 
-	// Remove any duplicates before returning the list
-	auto end = std::unique(returnList.begin(), returnList.end());
+	// Remove any duplicates before returning the list (keeps the first of each)
+	std::unordered_set<Flow> seen;
+	auto end = std::remove_if(returnList.begin(), returnList.end(), [&seen](const Flow& f) { return !seen.insert(f).second; });
 	returnList.erase(end, returnList.end());
 
     return returnList;
@@ -1063,12 +1589,25 @@ std::vector<std::vector<Flow>> Controller::translateFlows(std::vector<Flow> flow
 {
 	std::vector<Flow> translatedFlows;
 	std::vector<Flow> duplicates;
-	for (Flow f : flows) {
-		if (f.getSwitchIP() == originalIP) {
-			Flow newFlow = Flow(newIP, f.getRulePrefix(), f.getNextHopIP(), f.isMod());
+
+	// Match on the packed address (placeholders like "-1" fall back to comparing the formatted strings)
+	uint32_t originalAddress = 0;
+	bool isAddress = Flow::parseIPv4(originalIP, originalAddress);
+
+	for (const Flow& f : flows) {
+		bool switchMatch = isAddress ? (f.getSwitchAddress() == originalAddress) : (f.getSwitchIP() == originalIP);
+		bool hopMatch = isAddress ? (f.getNextHopAddress() == originalAddress) : (f.getNextHopIP() == originalIP);
+
+		if (switchMatch) {
+			// Fresh copy of the rule (mod flags and DPIDs reset), action follows the old constructor call
+			Flow newFlow = f.inverseFlow();
+			newFlow.setAction(f.isMod());
+			newFlow.setSwitchIP(newIP);
 			translatedFlows.push_back(newFlow);
-		} else if (f.getNextHopIP() == originalIP) {
-			Flow newFlow = Flow(f.getSwitchIP(), f.getRulePrefix(), newIP, f.isMod());
+		} else if (hopMatch) {
+			Flow newFlow = f.inverseFlow();
+			newFlow.setAction(f.isMod());
+			newFlow.setNextHopIP(newIP);
 			translatedFlows.push_back(newFlow);
 		}
 	}
@@ -1089,53 +1628,31 @@ std::vector<std::vector<Flow>> Controller::translateFlows(std::vector<Flow> flow
     return {translatedFlows, duplicates};
 }
 
-Node Controller::getBestDomainNode(int firstIndex, int secondIndex)
+const Node* Controller::getBestDomainNode(int firstIndex, int secondIndex)
 {
 	for (Node* n : domainNodes) {
 		if (n->connectsToTopology(firstIndex) && n->connectsToTopology(secondIndex)) {
-			return *n;
+			return n;
 		}
 	}
-    return Node();
+    return nullptr;
 }
 
 int Controller::getNumLinks(std::string IP, bool Switch)
 {
-	Node n = referenceTopology->getNodeByIP(IP);
-	std::vector<std::string> IPList = n.getLinks();
-	
-	int count = 0;
-
-	for (std::string ip : IPList) {
-		Node m = referenceTopology->getNodeByIP(ip);
-		if (m.isSwitch() && Switch) {
-			count++;
-		} else if (!Switch) {
-			count++;
-		}
-	}
-
-    return count;
+	// Counted from the adjacency graph, Switch only counts neighbours that are switches
+    return referenceTopology->getLinkCount(IP, Switch);
 }
 
 std::vector<std::string> Controller::getInterfaces(std::string IP)
 {
 	std::vector<std::string> returnList;
 
-	// Run ifconfig to display interface and inet address, filter everything else out
-	std::string sysCmd = "ifconfig | grep -E '^[a-zA-Z0-9]|inet ' | awk '/^[a-zA-Z0-9]/ {iface=$1} /inet / {print iface, $2}' | sed 's/addr://'";
-	// Output format "interface ip-address"
-
-	// Match the interface name to the given parameter IP, use the interface name to get the DPID
-    std::string output = exec(sysCmd.c_str(), IP);
-	// Use ' ' as delimiter, only take everything before the delimiter
-	if (output.empty()) {
+	// Find the interface that owns the IP, it's named after the switch's bridge
+	std::string interface = getInterfaceName(IP);
+	if (interface.empty()) {
 		return std::vector<std::string>();
 	}
-	if (output.find(' ') == std::string::npos) {
-		return std::vector<std::string>();
-	}
-	std::string interface = output.substr(0, output.find(' '));
 
 	// Use exec command to get total list of interfaces (each interface will be separated by a newline)
 	std::string sysCommand = "sudo ovs-ofctl show " + interface + " | awk -F'[()]' '/addr:/ {print $2}'";
@@ -1209,6 +1726,7 @@ Controller::Controller()
 	sockvf = -1;
 	sockfh = -1;
 	sockCC = -1;
+	epollCC = -1;
 	referenceTopology = nullptr;
 	ofFlag = false;
 	vfFlag = false;
@@ -1216,20 +1734,18 @@ Controller::Controller()
 	pauseOutput = false;
 	pause_rst = false;
 	noRst = false;
-	fhXID = -1;
-	expFlowXID = -1;
-	recvSharedFlag = true;
-	forceStopShared = false;
+	fhXID = 0;
+	fhXIDPending = false;
+	expFlowXID = 0;
+	expFlowXIDPending = false;
+	directFlowInstall = false;
 	basePort = -1;
 	gotFlowMod = false;
-	ALLOW_CCPDN_RECV = false;
 
 	ignoreFlows.clear();
-	CCPDN_FLOW_RESPONSE.clear();
-	CCPDN_FLOW_SUCCESS.clear();
-	CCPDN_FLOW_FAIL.clear();
-	acceptedCC.clear();
+	ccpdnPeers.clear();
 	sharedFlows.clear();
+	flowListReplies.clear();
 	sharedPacket.clear();
 	domainNodes.clear();
 }
@@ -1244,6 +1760,7 @@ Controller::Controller(Topology* t) {
 	sockvf = -1;
 	sockfh = -1;
 	sockCC = -1;
+	epollCC = -1;
 	referenceTopology = t;
 	ofFlag = false;
 	vfFlag = false;
@@ -1251,21 +1768,19 @@ Controller::Controller(Topology* t) {
 	pauseOutput = false;
 	pause_rst = false;
 	noRst = false;
-	fhXID = -1;
-	expFlowXID = -1;
-	recvSharedFlag = true;
-	forceStopShared = false;
+	fhXID = 0;
+	fhXIDPending = false;
+	expFlowXID = 0;
+	expFlowXIDPending = false;
+	directFlowInstall = false;
 	basePort = -1;
 	gotFlowMod = false;
-	ALLOW_CCPDN_RECV = false;
 
 	ignoreFlows.clear();
-	CCPDN_FLOW_RESPONSE.clear();
-	CCPDN_FLOW_SUCCESS.clear();
-	CCPDN_FLOW_FAIL.clear();
-	acceptedCC.clear();
+	ccpdnPeers.clear();
 	sharedPacket.clear();
 	sharedFlows.clear();
+	flowListReplies.clear();
 	domainNodes.clear();
 }
 
@@ -1274,7 +1789,11 @@ Controller::~Controller()
 {
 	stopCCPDNServer();
 	closeSockets();
-	acceptedCC.clear();
+}
+
+void Controller::setTopology(Topology* t)
+{
+	referenceTopology = t;
 }
 
 void Controller::setControllerIP(std::string Controller_IP, std::string Controller_Port)
@@ -1394,7 +1913,7 @@ bool Controller::linkFlow()
 	return true;
 }
 
-bool Controller::startController(bool* thread)
+bool Controller::startController(std::atomic<bool>* thread)
 {
 	*thread = true;
 
@@ -1409,7 +1928,7 @@ bool Controller::startController(bool* thread)
 	return false;
 }
 
-bool Controller::startFlow(bool *thread)
+bool Controller::startFlow(std::atomic<bool>* thread)
 {
 	*thread = true;
 
@@ -1418,6 +1937,8 @@ bool Controller::startFlow(bool *thread)
 	flowThread.detach();
 
 	if (linkFlow()) {
+		// Flow operations need DPIDs -- resolve them now rather than on every add/remove
+		loadDPIDs();
 		return true;
 	}
 
@@ -1451,47 +1972,39 @@ bool Controller::freeLink()
 bool Controller::addFlowToTable(Flow f)
 {    
 	// Set reference DPIDs
-	std::string switchDP = std::to_string(getDPID(f.getSwitchIP()));
-    std::string output = std::to_string(getOutputPort(f.getSwitchIP(), f.getNextHopIP()));
-	f.setDPID(switchDP, output);
+	uint64_t switchDP = getDPID(f.getSwitchIP());
+    int output = getOutputPort(f.getSwitchIP(), f.getNextHopIP());
 
-	if (switchDP == "-1") {
+	if (switchDP == DPID_NONE) {
 		loggyErr("[CCPDN-ERROR]: Could not resolve DPID for " + f.getSwitchIP() + "\n");
 		pauseOutput = false;
-		recvSharedFlag = true;
 		return false;
-	} else if (output == "-1") {
+	} else if (output == -1) {
 		loggyErr("[CCPDN-ERROR]: Could not resolve output port for " + f.getNextHopIP() + "\n");
 		pauseOutput = false;
-		recvSharedFlag = true;
 		return false;
 	}
+	f.setDPID(switchDP, output);
 
 	// Ensure the flow we are adding is either within our domain, or inter-domain at the least
 	if (!validateFlow(f)) {
 		// If our flow is inter-topology (invalid), instead add it directly to sharedFlows for immediate verification/remapping
 		loggy << "[CCPDN]: Flow is inter-topology, adding to shared flows for verification/remapping" << std::endl;
 
-		recvSharedFlag = false;
-		forceStopShared = true;
-		std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Temp fix to allow sharedFlows to clear/get ready
-
-		// Lock the sharedFlows mutex to prevent early clearing of the vector
+		// Hand the flow to the flow handler, it's picked up with the next drained batch
 		f.setMod(true);
-		{
-			std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-			sharedFlows.push_back(f);
-		}
+		pushSharedFlow(f);
 		return true;
 	}
 
 	// Update XID mapping, use to track the return flow
 	int genXID = generateXID(referenceTopology->hostIndex);
-	expFlowXID = genXID;
+	expFlowXID = static_cast<uint32_t>(genXID);
+	expFlowXIDPending = true;
 	updateXIDMapping(genXID, f.getSwitchIP(), f.getNextHopIP());
 
 	// Send the FlowHandler message and wait for response
-	if (!sendFlowHandlerMessage("addflow-" + f.flowToStr(true) + "-" + std::to_string(genXID))) {
+	if (!sendFlowInstall(f, true, genXID)) {
 		loggyErr("[CCPDN-ERROR]: Failed to add flow\n");
 		pause_rst = false;
 		pauseOutput = false;
@@ -1510,16 +2023,9 @@ bool Controller::removeFlowFromTable(Flow f)
 	if (!validateFlow(f)) {
 		loggy << "[CCPDN]: Flow is inter-topology, adding to shared flows for verification/remapping" << std::endl;
 
-		recvSharedFlag = false;
-		forceStopShared = true;
-		std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Temp fix to allow sharedFlows to clear/get ready
-
-		// Lock the sharedFlows mutex to prevent early clearing of the vector
+		// Hand the flow to the flow handler, it's picked up with the next drained batch
 		f.setMod(true);
-		{
-			std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-			sharedFlows.push_back(f);
-		}
+		pushSharedFlow(f);
 		return true;
 	}
 
@@ -1529,21 +2035,19 @@ bool Controller::removeFlowFromTable(Flow f)
     for (Flow existingFlow : flows) {
         if (existingFlow == f) {
 			// Set our DPIDs for reference
-			std::string switchDP = std::to_string(getDPID(existingFlow.getSwitchIP()));
-			std::string output = std::to_string(getOutputPort(existingFlow.getSwitchIP(), existingFlow.getNextHopIP()));
-			existingFlow.setDPID(switchDP, output);
+			uint64_t switchDP = getDPID(existingFlow.getSwitchIP());
+			int output = getOutputPort(existingFlow.getSwitchIP(), existingFlow.getNextHopIP());
 
-			if (switchDP == "-1") {
+			if (switchDP == DPID_NONE) {
 				loggyErr("[CCPDN-ERROR]: Could not resolve DPID for " + existingFlow.getSwitchIP() + "\n");
 				pauseOutput = false;
-				recvSharedFlag = true;
 				return false;
-			} else if (output == "-1") {
+			} else if (output == -1) {
 				loggyErr("[CCPDN-ERROR]: Could not resolve output port for " + existingFlow.getNextHopIP() + "\n");
 				pauseOutput = false;
-				recvSharedFlag = true;
 				return false;
 			}
+			existingFlow.setDPID(switchDP, output);
 
 			// This method isn't necessary since we can only retrieve valid flows at this point
 			// if (!validateFlow(existingFlow)) {
@@ -1556,14 +2060,13 @@ bool Controller::removeFlowFromTable(Flow f)
 			updateXIDMapping(genXID, existingFlow.getSwitchIP(), existingFlow.getNextHopIP());
             
 			// Send the removal message to the controller
-			return sendFlowHandlerMessage("removeflow-" + existingFlow.flowToStr(true) + "-" + std::to_string(genXID));
+			return sendFlowInstall(existingFlow, false, genXID);
         }
     }
     
     // No matching flow found
     loggyErr("[CCPDN-ERROR]: No matching flow found to remove\n");
 	pauseOutput = false;
-	recvSharedFlag = true;
     return false;
 }
 
@@ -1572,65 +2075,66 @@ std::vector<Flow> Controller::retrieveFlows(std::string IP, bool pause)
 	std::vector<Flow> flows;
 
 	// Validate the source IP address (must be in local topology, or is a domain node)
-	if (!referenceTopology->isLocal(IP, false) && !referenceTopology->getNodeByIP(IP).isDomainNode()) {
+	if (!referenceTopology->isLocal(IP, false) && !referenceTopology->getNodeView(IP).isDomainNode()) {
 		loggyErr("[CCPDN-ERROR]: IP address is not valid for request\n");
 		pauseOutput = false;
-		recvSharedFlag = true;
 		return flows;
 	}
 
-	// Wait for ofFlag to be set to true, indicating we have received the flow list
-	bool sent = false;
-	int localCount = 0;
+	// Hold off the controller thread's flag reset until the flow list has been read
 	pause_rst = true;
 	fhFlag = false;
-	while (!fhFlag) {
-		// Timeout for 900ms
-		if (localCount > 180) {
-			loggyErr("[CCPDN-ERROR]: Timeout waiting for flow list from controller\n");
-			pause_rst = false;
-			if (pause) {
-				pauseOutput = false;
-			}
-			return flows;
+
+	// Get the DPID associated with the given IP address
+	uint64_t switchDP = getDPID(IP);
+	std::string dpid = std::to_string(switchDP);
+	if (switchDP == DPID_NONE) {
+		loggyErr("[CCPDN-ERROR]: Could not find DPID for IP: " + IP + "\n");
+		pause_rst = false;
+		if (pause) {
+			pauseOutput = false;
 		}
-		if (!sent) {
-			// Get the DPID associated with the given IP address
-			std::string dpid = std::to_string(getDPID(IP));
+		return flows;
+	}
 
-			if (dpid == "-1") {
-				loggyErr("[CCPDN-ERROR]: Could not find DPID for IP: " + IP + "\n");
-				pause_rst = false;
-				if (pause) {
-					pauseOutput = false;
-				}
-				return flows;
-			}
+	// Drop entries left over from an earlier (timed out) listing
+	flowListReplies.clear();
 
-			// Update XID mapping, use to track the return flow
-			int genXID = generateXID(referenceTopology->hostIndex);
-			fhXID = genXID;
-			updateXIDMapping(genXID, IP, "");
-
-			// Send the FlowHandler message and wait for response
-			if (!sendFlowHandlerMessage("listflows-" + dpid + "-" + std::to_string(genXID))) {
-				loggyErr("[CCPDN-ERROR]: Failed to retrieve flow list\n");
-				pause_rst = false;
-				if (pause) {
-					pauseOutput = false;
-				}
-				return flows;
-			}
-			else {
-				sent = true;
-			}
+	// Update XID mapping, use to track the return flow
+	int genXID = generateXID(referenceTopology->hostIndex);
+	fhXID = static_cast<uint32_t>(genXID);
+	fhXIDPending = true;
+	updateXIDMapping(genXID, IP, "");
+
+	// Send the FlowHandler message
+	if (!sendFlowHandlerMessage("listflows-" + dpid + "-" + std::to_string(genXID))) {
+		loggyErr("[CCPDN-ERROR]: Failed to retrieve flow list\n");
+		pause_rst = false;
+		if (pause) {
+			pauseOutput = false;
+		}
+		return flows;
+	}
+
+	// Sleep until handleStatsReply raises fhFlag, indicating we have received the flow list
+	if (!fhFlag.waitFor(true, std::chrono::milliseconds(FLOW_LIST_REPLY_TIMEOUT_MS))) {
+		loggyErr("[CCPDN-ERROR]: Timeout waiting for flow list from controller\n");
+		// A late reply must not raise fhFlag for the next request
+		fhXIDPending = false;
+		pause_rst = false;
+		if (pause) {
+			pauseOutput = false;
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(5));
-		localCount++;
+		return flows;
 	}
 
-	for (Flow f : sharedFlows) {
-		if (f.getSwitchIP() == IP && !f.isMod()) {
+	std::vector<Flow> listed;
+	flowListReplies.drain(listed);
+
+	uint32_t address = 0;
+	Flow::parseIPv4(IP, address);
+	for (const Flow& f : listed) {
+		if (f.getSwitchAddress() == address && !f.isMod()) {
 			flows.push_back(f);
 		}
 	}
@@ -1638,7 +2142,6 @@ std::vector<Flow> Controller::retrieveFlows(std::string IP, bool pause)
 	// Reset flags since the statsreply packet has been received
 	fhFlag = false;
 	pause_rst = false;
-	recvSharedFlag = true;
 	if (pause) {
 		pauseOutput = false;
 	}
@@ -1657,7 +2160,18 @@ bool Controller::addDomainNode(Node* n)
 
 bool Controller::sendOpenFlowMessage(std::vector<unsigned char> data)
 {
-	std::string msg = "";
+	return sendOpenFlowMessage(std::span<const unsigned char>(data));
+}
+
+bool Controller::sendOpenFlowMessage(std::span<const unsigned char> data)
+{
+	// Nothing encoded (e.g. buffer too small)
+	if (data.empty()) {
+		loggyErr("[CCPDN-ERROR]: Refusing to send an empty OpenFlow Message.\n");
+		return false;
+	}
+
+	const char* msg = "";
 	std::string warningString = "";
 #ifdef __unix__
 	// Send the header
@@ -1665,13 +2179,14 @@ bool Controller::sendOpenFlowMessage(std::vector<unsigned char> data)
 	if (bytes_sent < 0) {
 		loggyErr("[CCPDN-ERROR]: Failed to send OpenFlow Message.\n");
 		return false;
-	} else if (bytes_sent != data.size()) {
+	} else if (static_cast<size_t>(bytes_sent) != data.size()) {
 		warningString = std::to_string(bytes_sent) + " bytes transmitted but expected " + std::to_string(data.size()) + " bytes.";
 	}
 #endif
 
 	// Grab header (unsafe, only for logs)
 	ofp_header Header;
+	std::memset(&Header, 0xFF, sizeof(ofp_header));
 	if (!(data.size() < sizeof(ofp_header))) { // Only copy if we have 8 bytes or more
 		std::memcpy(&Header, data.data(), sizeof(ofp_header));
 	}
@@ -1741,9 +2256,9 @@ bool Controller::sendOpenFlowMessage(std::vector<unsigned char> data)
 	}
 
 	bool warning = warningString.empty() ? false : true;
-	std::string CCPDN_Type = warning ? "[CCPDN-WARNING]: " : "[CCPDN]: ";
+	const char* CCPDN_Type = warning ? "[CCPDN-WARNING]: " : "[CCPDN]: ";
 
-	loggyMsg(CCPDN_Type + "Sent " + msg + " message. " + warningString + "\n");
+	loggy << CCPDN_Type << "Sent " << msg << " message. " << warningString << "\n";
 
 	return true;
 }
@@ -1770,12 +2285,17 @@ bool Controller::sendVeriFlowMessage(std::string message)
 
 bool Controller::sendFlowHandlerMessage(std::string message)
 {
-	// Convert message to sendable format
-	std::vector<char> Msg(message.begin(), message.end());
+	// Commands end at a newline, so the FlowInterface can tell them apart from the frames around them
+	message += "\n";
 
 #ifdef __unix__
-	// Recast message as char array and send it
-	ssize_t bytes_sent = send(sockfh, Msg.data(), Msg.size(), 0);
+	iovec parts[1];
+	parts[0].iov_base = message.data();
+	parts[0].iov_len = message.size();
+	if (!writeFlowHandler(parts, 1)) {
+		loggyErr("[CCPDN-ERROR]: Failed to send request to FlowHandler.\n");
+		return false;
+	}
 #endif
 
 	// Print send message
@@ -1784,48 +2304,279 @@ bool Controller::sendFlowHandlerMessage(std::string message)
     return true;
 }
 
-bool Controller::sendCCPDNMessage(int socket, std::string message)
+bool Controller::sendFlowInstall(Flow f, bool add, int XID)
 {
-    // Convert message to sendable format, add null-terminating char
-	std::vector<char> Msg(message.begin(), message.end());
-	// Append null-terminating char as delimiter
-	Msg.push_back('\0');
+	// Text command -- the FlowInterface parses it and builds the flow mod in POX
+	if (!directFlowInstall) {
+		return sendFlowHandlerMessage((add ? "addflow-" : "removeflow-") + f.flowToStr(true) + "-" + std::to_string(XID));
+	}
+
+	// Direct install -- encode the flow mod here, the FlowInterface only forwards the bytes to the switch
+	std::span<unsigned char> out = OpenFlowMessage::scratch();
+	size_t length = OpenFlowMessage::encodeFlowMod(out, f, add ? OFPFC_ADD : OFPFC_DELETE, XID);
+	if (length == 0) {
+		loggyErr("[CCPDN-ERROR]: Failed to encode flow mod for " + f.flowToStr(false) + "\n");
+		return false;
+	}
+
+	return sendFlowHandlerFrame(std::to_string(f.getSwitchDPID()), out.first(length));
+}
+
+bool Controller::sendFlowHandlerFrame(std::string dpid, std::span<const unsigned char> data)
+{
+	// Frame header -- ofmsg-[dpid]-[length] followed by a newline, then the raw OpenFlow message
+	std::string header = "ofmsg-" + dpid + "-" + std::to_string(data.size()) + "\n";
 
 #ifdef __unix__
-	// Recast message as char array and send it
-	ssize_t bytes_sent = send(socket, Msg.data(), Msg.size(), 0);
+	// Send header and message together
+	iovec parts[2];
+	parts[0].iov_base = header.data();
+	parts[0].iov_len = header.size();
+	parts[1].iov_base = const_cast<unsigned char*>(data.data());
+	parts[1].iov_len = data.size();
+
+	if (!writeFlowHandler(parts, 2)) {
+		loggyErr("[CCPDN-ERROR]: Failed to send OpenFlow frame to FlowHandler.\n");
+		return false;
+	}
+#endif
+
+	// Print send message
+	loggyMsg("[CCPDN]: Sent FlowHandler OpenFlow frame.\n");
+
+	return true;
+}
+
+#ifdef __unix__
+bool Controller::writeFlowHandler(iovec* parts, int count)
+{
+	// One writer at a time, and the whole of it -- a partial frame would make the FlowInterface read the next command as its body
+	std::lock_guard<std::mutex> lock(flowHandlerMutex);
+	while (count > 0) {
+		ssize_t bytes_sent = writev(sockfh, parts, count);
+		if (bytes_sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+
+		// Skip what went out and carry on from the first unsent byte
+		size_t remaining = static_cast<size_t>(bytes_sent);
+		while (count > 0 && remaining >= parts[0].iov_len) {
+			remaining -= parts[0].iov_len;
+			parts++;
+			count--;
+		}
+		if (count > 0) {
+			parts[0].iov_base = static_cast<char*>(parts[0].iov_base) + remaining;
+			parts[0].iov_len -= remaining;
+		}
+	}
+	return true;
+}
 #endif
 
+bool Controller::sendCCPDNMessage(const CCPDNPeerHandle& peer, std::string message)
+{
+	if (peer == nullptr) {
+		return false;
+	}
+
+	if (!sendCCPDNFrame(*peer, message)) {
+		loggyErr("[CCPDN-ERROR]: Failed to send CCPDN message\n");
+		// Part of a frame may have gone out, the stream is unusable -- the peer manager reconnects if it's ours to
+		closePeer(peer);
+		return false;
+	}
+
 	// Print send message
 	loggyMsg("[CCPDN]: Sent CCPDN Message.\n");
-	for (int i = 0; i < Msg.size(); ++i) {
-		loggyMsg(Msg[i]);
+	if (Digest::isBinary(message)) {
+		loggyMsg("<binary digest, " + std::to_string(message.size()) + " bytes>");
+	} else {
+		loggyMsg(message);
 	}
 	loggyMsg("\n");
 	return true;
 }
 
+bool Controller::sendCCPDNFrame(CCPDNPeer& peer, const std::string& message)
+{
+	{
+		// Only this peer's writers wait here, so heartbeats can't land in the middle of another thread's frame
+		std::lock_guard<std::mutex> sendLock(peer.sendMutex);
+		if (peer.closed) {
+			return false;
+		}
+
+		// Prefix the message with its length so the receiver can reassemble it whatever its size (NUL-terminated until the peer agreed)
+		std::vector<uint8_t> frame = peer.lengthFramed ? FrameBuffer::encode(message) : FrameBuffer::encodeDelimited(message);
+		if (!writeCCPDNFrame(peer.socket, frame)) {
+			return false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(ccpdnMutex);
+	peer.lastSent = CCPDNPeer::Clock::now();
+	return true;
+}
+
+bool Controller::writeCCPDNFrame(int socket, const std::vector<uint8_t>& frame)
+{
+#ifdef __unix__
+	// Large frames may take several send() calls, a send that times out means the peer stopped reading
+	size_t bytes_sent = 0;
+	while (bytes_sent < frame.size()) {
+		ssize_t sent = send(socket, frame.data() + bytes_sent, frame.size() - bytes_sent, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		bytes_sent += sent;
+	}
+#endif
+	return true;
+}
+
+bool Controller::startLengthFraming(const CCPDNPeerHandle& peer)
+{
+	if (peer == nullptr) {
+		return false;
+	}
+
+	bool sent = true;
+	{
+		// Under the send lock, so no other frame can go out between the marker and the switch
+		std::lock_guard<std::mutex> sendLock(peer->sendMutex);
+		if (peer->closed) {
+			return false;
+		}
+		if (peer->lengthFramed) {
+			return true;
+		}
+
+		// The marker is the last NUL-delimited frame we send, the peer switches its reader when it sees it
+		sent = writeCCPDNFrame(peer->socket, FrameBuffer::encodeDelimited("F" + std::to_string(CCPDN_FRAMING_VERSION)));
+		peer->lengthFramed = sent;
+	}
+
+	if (!sent) {
+		loggyErr("[CCPDN-ERROR]: Failed to send CCPDN message\n");
+		closePeer(peer);
+	}
+	return sent;
+}
+
+bool Controller::sendCCPDNDigest(const CCPDNPeerHandle& peer, Digest& digest)
+{
+	if (peer == nullptr) {
+		return false;
+	}
+
+	// Binary only once the peer has agreed to it, JSON otherwise
+	bool binary = false;
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		binary = peer->binary;
+	}
+
+	return sendCCPDNMessage(peer, binary ? digest.toBinary() : digest.toJson());
+}
+
 bool Controller::synchTopology(Digest d)
 {
-	// Create vector of nodes to hold our topology data from payload
-	std::vector<Node> topologyData = Topology::string_toTopology(d.getPayload());
+	// Override the topology located at the "host index" field from the digest
+	int hostIndex = d.getHostIndex();
+	std::string payload = d.getPayload();
+	size_t headerEnd = payload.find('\n');
+
+	// Delta: "D<from>-<to>" followed by one change per line, only applies on top of version <from>
+	if (!payload.empty() && payload[0] == 'D') {
+		uint64_t fromVersion = 0;
+		uint64_t toVersion = 0;
+		try {
+			size_t split = payload.find('-');
+			fromVersion = std::stoull(payload.substr(1, split - 1));
+			toVersion = std::stoull(payload.substr(split + 1, headerEnd - split - 1));
+		} catch (std::exception& e) {
+			loggyErr("[CCPDN-ERROR]: Failed to parse topology delta header.\n");
+			return false;
+		}
+
+		// We missed something (or our copy was edited) -- ask for what we're missing instead
+		uint64_t currentVersion = referenceTopology->getVersion(hostIndex);
+		if (fromVersion != currentVersion) {
+			loggy << "[CCPDN]: Topology " << hostIndex << " delta doesn't follow our copy, requesting resync" << std::endl;
+			requestUpdate(hostIndex);
+			return false;
+		}
+
+		std::vector<Topology::Delta> deltas;
+		std::string body = (headerEnd == std::string::npos) ? "" : payload.substr(headerEnd + 1);
+		if (!Topology::string_toDeltas(body, deltas) || deltas.size() != toVersion - fromVersion) {
+			loggyErr("[CCPDN-ERROR]: Failed to parse topology delta, requesting snapshot.\n");
+			referenceTopology->setVersion(hostIndex, TOPOLOGY_VERSION_UNKNOWN);
+			requestUpdate(hostIndex);
+			return false;
+		}
+
+		bool nodesChanged = false;
+		for (const Topology::Delta& delta : deltas) {
+			if (!referenceTopology->applyDelta(hostIndex, delta)) {
+				loggyErr("[CCPDN-ERROR]: Topology delta doesn't match our copy, requesting snapshot.\n");
+				referenceTopology->setVersion(hostIndex, TOPOLOGY_VERSION_UNKNOWN);
+				requestUpdate(hostIndex);
+				return false;
+			}
+			nodesChanged |= (delta.op == Topology::Delta::NODE_ADD || delta.op == Topology::Delta::NODE_REMOVE);
+		}
+
+		// Only our own switches have cached DPIDs, other topologies' changes leave them valid
+		if (nodesChanged && hostIndex == referenceTopology->hostIndex) {
+			clearDPIDMap();
+		}
+		return true;
+	}
+
+	// Snapshot: "V<version>" line first, or plain topology text from instances without delta sync
+	std::vector<Node> topologyData;
+	bool versioned = (!payload.empty() && payload[0] == 'V' && headerEnd != std::string::npos);
+	uint64_t version = TOPOLOGY_VERSION_UNKNOWN;
+	if (versioned) {
+		try {
+			version = std::stoull(payload.substr(1, headerEnd - 1));
+		} catch (std::exception& e) {
+			loggyErr("[CCPDN-ERROR]: Failed to parse topology snapshot header.\n");
+			return false;
+		}
+		topologyData = Topology::string_toTopology(payload.substr(headerEnd + 1));
+	} else {
+		topologyData = d.getTopology();
+	}
 
 	if (topologyData.empty()) {
 		loggyErr("[CCPDN-ERROR]: Failed to parse topology data from payload.\n");
 		return false;
 	}
 
-	// Override the current topology located at the "host index" field from the digest
-	int hostIndex = d.getHostIndex();
-	// Clears the vector of node objects at the host index
-	referenceTopology->topologyList[hostIndex].clear();
-	// Replace them with our new topology data
-	referenceTopology->topologyList[hostIndex] = topologyData;
+	// Replace the node objects at the host index with our new topology data (keeps the IP index in step)
+	referenceTopology->replaceTopology(hostIndex, topologyData);
+	if (versioned) {
+		referenceTopology->setVersion(hostIndex, version);
+	}
+
+	// Node IPs may have moved -- if they're ours, drop cached DPIDs so they're resolved against the new topology
+	if (hostIndex == referenceTopology->hostIndex) {
+		clearDPIDMap();
+	}
 
 	return true;
 }
 
-bool Controller::sendUpdate(bool global, int destinationIndex)
+bool Controller::sendUpdate(bool global, int destinationIndex, uint64_t knownVersion)
 {
 	// Verify destination index exists within current topology
 	if (destinationIndex < 0 || destinationIndex >= referenceTopology->getTopologyCount()) {
@@ -1839,34 +2590,78 @@ bool Controller::sendUpdate(bool global, int destinationIndex)
 		return false;
 	}
 
-	// Grab string format of local topology
-	std::string topOutput = referenceTopology->topology_toString(hostIndex);
-
-	if (topOutput.empty()) {
-		loggyErr("[CCPDN-ERROR]: Failed to convert topology to string.\n");
-		return false;
-	}
-
-	// Create a digest object with topOutput as payload
-	Digest singleMessage(false, true, false, hostIndex, destinationIndex, topOutput);
-
-	// If the global var is true, send this digest to all known topologies (forcing them all to update)
+	// If the global var is true, send our changes to all known topologies (forcing them all to update)
 	if (global) {
 		bool success = true;
 		for (int i = 0; i < referenceTopology->getTopologyCount(); i++) {
-			if (i != hostIndex) {
-				Digest message(false, true, false, hostIndex, i, topOutput);
-				// Send the digest
-				if (!sendCCPDNMessage(*getSocketFromIndex(i), message.toJson())) {
-					success = false;
-				}
+			if (i != hostIndex && !sendTopology(i, TOPOLOGY_VERSION_UNKNOWN, true)) {
+				success = false;
 			}
 		}
 		return success;
 	}
 
-	// Send the digest
-	return sendCCPDNMessage(*getSocketFromIndex(destinationIndex), singleMessage.toJson());
+	return sendTopology(destinationIndex, knownVersion, false);
+}
+
+bool Controller::sendTopology(int destinationIndex, uint64_t knownVersion, bool skipIfCurrent)
+{
+	int hostIndex = referenceTopology->hostIndex;
+	CCPDNPeerHandle destination = getPeer(destinationIndex);
+	if (destination == nullptr) {
+		loggyErr("[CCPDN-ERROR]: No connection to topology " + std::to_string(destinationIndex) + "\n");
+		return false;
+	}
+
+	// Without a version from the request, assume the destination has whatever we last sent it
+	bool deltaPeer = false;
+	{
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		deltaPeer = destination->delta;
+		auto it = peerTopologyVersions.find(destinationIndex);
+		if (knownVersion == TOPOLOGY_VERSION_UNKNOWN && it != peerTopologyVersions.end()) {
+			knownVersion = it->second;
+		}
+	}
+
+	uint64_t version = referenceTopology->getVersion(hostIndex);
+	if (deltaPeer && skipIfCurrent && knownVersion == version) {
+		return true;
+	}
+
+	// Older instances only understand the plain topology text, everyone else gets the changes since their version if we still have them
+	std::string payload;
+	std::vector<Topology::Delta> deltas;
+	if (!deltaPeer) {
+		payload = referenceTopology->topology_toString(hostIndex);
+	} else if (referenceTopology->getDeltasSince(hostIndex, knownVersion, deltas)) {
+		payload = "D" + std::to_string(knownVersion) + "-" + std::to_string(version) + "\n" + Topology::deltas_toString(deltas);
+	} else {
+		payload = "V" + std::to_string(version) + "\n" + referenceTopology->topology_toString(hostIndex);
+	}
+
+	Digest message(false, true, false, hostIndex, destinationIndex, payload);
+	if (!sendCCPDNDigest(destination, message)) {
+		return false;
+	}
+
+	if (deltaPeer) {
+		std::lock_guard<std::mutex> lock(ccpdnMutex);
+		peerTopologyVersions[destinationIndex] = version;
+	}
+	return true;
+}
+
+bool Controller::requestUpdate(int index)
+{
+	CCPDNPeerHandle peer = getPeer(index);
+	if (peer == nullptr) {
+		return false;
+	}
+
+	// Tell the owner which version we hold so it can answer with just the changes
+	Digest request(true, false, false, referenceTopology->hostIndex, index, "v" + std::to_string(referenceTopology->getVersion(index)));
+	return sendCCPDNDigest(peer, request);
 }
 
 std::vector<Node*> Controller::getDomainNodes()
@@ -1884,49 +2679,123 @@ void Controller::rstVeriFlowFlag()
 	vfFlag = false;
 }
 
-int Controller::getDPID(std::string IP)
+uint64_t Controller::getDPID(std::string IP)
 {
     // Ensure valid host index
 	int hostIndex = referenceTopology->hostIndex;
 	if (hostIndex < 0 || hostIndex >= referenceTopology->getTopologyCount()) {
 		loggy << "[CCPDN-ERROR]: Couldn't resolve DPID, host index is invalid!\n";
-		return -1;
+		return DPID_NONE;
+	}
+
+	// Check if we can get it from mapping first, if not we go through long process of adding it
+	uint64_t dpid = getDPIDFromMap(IP);
+	if (dpid != DPID_NONE) {
+		return dpid;
 	}
 
 	// Ensure IP exists within global topology -- leave local topology verification to addFlow, delFlow, listFlow functions
-	Node n = referenceTopology->getNodeByIP(IP);
-	if (n.isEmptyNode()) {
+	if (referenceTopology->getNodeView(IP).isEmptyNode()) {
 		loggy << "[CCPDN-ERROR]: Couldn't resolve DPID, IP doesn't exist!\n";
-		return -1;
+		return DPID_NONE;
+	}
+
+	// Add the DPID to our mapping for future use (failures aren't cached so they can be retried)
+	dpid = resolveDPID(IP);
+	if (dpid != DPID_NONE) {
+		addDPIDToMap(IP, dpid);
+	}
+
+	return dpid;
+}
+
+std::string Controller::getInterfaceName(std::string IP)
+{
+	// Answer from the netlink-backed interface table whenever it's available
+	InterfaceTable& interfaces = InterfaceTable::getInstance();
+	if (interfaces.isReady()) {
+		return interfaces.getInterfaceByIP(IP);
 	}
 
 	// Run ifconfig to display interface and inet address, filter everything else out
-	std::string command1 = "ifconfig | grep -E '^[a-zA-Z0-9]|inet ' | awk '/^[a-zA-Z0-9]/ {iface=$1} /inet / {print iface, $2}' | sed 's/addr://'";
+	std::string sysCmd = "ifconfig | grep -E '^[a-zA-Z0-9]|inet ' | awk '/^[a-zA-Z0-9]/ {iface=$1} /inet / {print iface, $2}' | sed 's/addr://'";
 	// Output format "interface ip-address"
 
-	// Match the interface name to the given parameter IP, use the interface name to get the DPID
-	std::string sysCommand = command1;
-    std::string output = exec(sysCommand.c_str(), IP);
+	// Match the interface name to the given parameter IP
+	std::string output = exec(sysCmd.c_str(), IP);
 	// Use ' ' as delimiter, only take everything before the delimiter
-	if (output.empty()) {
-		return -1;
+	if (output.empty() || output.find(' ') == std::string::npos) {
+		return "";
 	}
-	if (output.find(' ') == std::string::npos) {
-		return -1;
+	return output.substr(0, output.find(' '));
+}
+
+uint64_t Controller::resolveDPID(std::string IP)
+{
+	// Match the interface name to the given parameter IP, use the interface name to get the DPID
+	std::string interface = getInterfaceName(IP);
+	if (interface.empty()) {
+		return DPID_NONE;
 	}
-	std::string interface = output.substr(0, output.find(' '));
 	
 	// Run sudo ovs-ofctl and parse output for dpid
 	//							 | awk '/dpid:/ {gsub(".*dpid:|\\s", ""); print}' -- Normal command string
 
 	std::string stringLiteral = " | awk '/dpid:/ {gsub(\".*dpid:|\\s\", \"\"); print}'";
-	sysCommand = "sudo ovs-ofctl show " + interface;
+	std::string sysCommand = "sudo ovs-ofctl show " + interface;
 
 	sysCommand.append(stringLiteral);
-	// Output format is just "dpid"
+	// Output format is just "dpid", 16 hex digits
 	std::string dpid = exec(sysCommand.c_str(), "-1");
+	if (dpid.empty() || dpid == "-1") {
+		return DPID_NONE;
+	}
+
+	try {
+		return std::stoull(dpid, nullptr, 16);
+	} catch (const std::exception& e) {
+		return DPID_NONE;
+	}
+}
+
+void Controller::loadDPIDs()
+{
+	// Resolve every local switch once up front, so flow operations only ever hit the map
+	int hostIndex = referenceTopology->hostIndex;
+	if (hostIndex < 0 || hostIndex >= referenceTopology->getTopologyCount()) {
+		return;
+	}
+
+	int resolved = 0;
+	for (Node n : referenceTopology->getTopology(hostIndex)) {
+		if (n.isSwitch() && getDPID(n.getIP()) != DPID_NONE) {
+			resolved++;
+		}
+	}
+
+	loggy << "[CCPDN]: Cached DPIDs for " << resolved << " local switch(es)" << std::endl;
+}
+
+void Controller::addDPIDToMap(std::string IP, uint64_t dpid)
+{
+	std::lock_guard<std::mutex> lock(dpidMapMutex);
+	dpidMap[IP] = dpid;
+}
 
-	return std::stoi(dpid);
+uint64_t Controller::getDPIDFromMap(std::string IP)
+{
+	std::lock_guard<std::mutex> lock(dpidMapMutex);
+	auto it = dpidMap.find(IP);
+	if (it != dpidMap.end()) {
+		return it->second;
+	}
+	return DPID_NONE;
+}
+
+void Controller::clearDPIDMap()
+{
+	std::lock_guard<std::mutex> lock(dpidMapMutex);
+	dpidMap.clear();
 }
 
 int Controller::getOutputPort(std::string srcIP, std::string dstIP)
@@ -1944,21 +2813,13 @@ int Controller::getOutputPort(std::string srcIP, std::string dstIP)
 	}
 
 	// Ensure both IPs exists within global topology -- leave local topology verification to addFlow, delFlow, listFlow functions
-	Node n = referenceTopology->getNodeByIP(dstIP);
-	if (n.isEmptyNode()) {
+	if (referenceTopology->getNodeView(dstIP).isEmptyNode()) {
 		return -1;
 	}
-	n = referenceTopology->getNodeByIP(srcIP);
-	if (n.isEmptyNode()) {
+	if (referenceTopology->getNodeView(srcIP).isEmptyNode()) {
 		return -1;
 	}
 
-	// Get amount of hosts/switches linked on each IP
-	int srcHostCount = getNumLinks(srcIP, false);
-
-	// Get links associated with our srcIP
-	std::vector<std::string> srcLinks = n.getLinks();
-
 	// // Get total list of interfaces associated with srcIP and dstIP
 	// std::vector<std::string> srcInterfaces = getInterfaces(srcIP);
 	// if (srcInterfaces.empty() || dstInterfaces.empty()) {
@@ -1966,20 +2827,13 @@ int Controller::getOutputPort(std::string srcIP, std::string dstIP)
 	// }
 	// This was actually not necessary. Oh well.
 
-	// Iterate through srcLinks and get the index matching our dstIP
-	int dstIndex = -1;
-	for (int i = 0; i < srcLinks.size(); i++) {
-		if (srcLinks[i] == dstIP) {
-			dstIndex = i;
-			break;
-		}
-	}
-	if (dstIndex == -1) { // No link/interface exists if this is true
+	// The link's port is precomputed in the adjacency graph (link count + 1-based link index)
+	int outputPort = referenceTopology->getLinkPort(srcIP, dstIP);
+	if (outputPort == -1) { // No link/interface exists if this is true
 		return -1;
 	}
 
 	// Add the port to our mapping for future use
-	int outputPort = srcHostCount + dstIndex + 1; // +1 to account for 1-based indexing for ports
 	addPortToMap(srcIP, dstIP, outputPort);
 	// Add the reverse mapping for the destination IP
 	addIPToMap(srcIP, outputPort, dstIP);
@@ -2002,14 +2856,13 @@ std::string Controller::getIPFromOutputPort(std::string srcIP, int outputPort)
 	}
 
 	// Iterate through each srcLink, and complete the normal mapping process
-	std::vector<std::string> srcLinks = referenceTopology->getNodeByIP(srcIP).getLinks();
+	std::vector<std::string> srcLinks = referenceTopology->getNodeView(srcIP).getLinks();
 	if (srcLinks.empty()) {
 		return "-1";
 	}
 
-	for (std::string link : srcLinks) {
-		Node n = referenceTopology->getNodeByIP(link);
-		if (n.isEmptyNode()) {
+	for (const std::string& link : srcLinks) {
+		if (referenceTopology->getNodeView(link).isEmptyNode()) {
 			continue;
 		}
 		// Function will auto-map the reverse for us
@@ -2024,18 +2877,12 @@ std::string Controller::getIPFromOutputPort(std::string srcIP, int outputPort)
 	}
 }
 
-void Controller::tryClearSharedFlows()
+void Controller::pushSharedFlow(Flow f)
 {
-	// Don't clear if recvShared is false
-	if (!recvSharedFlag) {
-		return;
-	}
+	sharedFlows.push(f);
 
-	// Clear the shared flows vector
-	{
-		std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-		sharedFlows.clear();
-	}
+	// Wake the flow handler so the new flow is processed immediately
+	TCPAnalyzer::ping();
 }
 
 Flow Controller::adjustCrossTopFlow(Flow f)
@@ -2098,6 +2945,7 @@ int Controller::generateXID(int topologyIndex)
 
 void Controller::veriFlowHandshake()
 {
+	std::lock_guard<std::mutex> lock(veriflowMutex);
 	sendVeriFlowMessage("[CCPDN] Hello");
 	recvVeriFlowMessages();
 	rstVeriFlowFlag();
@@ -2153,114 +3001,98 @@ void Controller::recvVeriFlowMessages()
 #endif
 }
 
-void Controller::handleStatsReply(ofp_stats_reply* reply)
+void Controller::handleStatsReply(const OpenFlowView& msg)
 {
-	// Null check
+	// Null check -- also rejects replies shorter than an ofp_stats_reply
+	const ofp_stats_reply* reply = msg.statsReply();
 	if (reply == nullptr) {
 		return;
 	}
 
 #ifdef __unix__
-	// Fix endian-ness of reply
-	reply->header.length = ntohs(reply->header.length);
-	reply->header.xid = ntohl(reply->header.xid);
-	reply->type = ntohs(reply->type);
-
 	// Only stats reply we care about are flows
-	if (reply->type != OFPST_FLOW) {
+	if (ntohs(reply->type) != OFPST_FLOW) {
 		return;
 	}
 
-	// Calculate body size
-	size_t body_size = reply->header.length - sizeof(ofp_stats_reply);
-	size_t offset = 0;
+	uint32_t xid = msg.xid();
+	std::span<const uint8_t> body = msg.body(offsetof(ofp_stats_reply, body));
+
+	// Port field of the first action (ofp_action_output) must fit inside the entry
+	const size_t min_entry_size = sizeof(ofp_flow_stats) + offsetof(ofp_action_header, port) + sizeof(uint16_t);
 
 	// Iterate through each flow_stat given in the packet
-	while (body_size >= sizeof(ofp_flow_stats)) {
+	while (body.size() >= sizeof(ofp_flow_stats)) {
 
 		// Cast ptr to access flow_stats struct
-		ofp_flow_stats* flow_stats = reinterpret_cast<ofp_flow_stats*>(reply->body + offset);
-		if (flow_stats == nullptr) {
-			loggyErr("[CCPDN-ERROR]: Couldn't read flow stats message.\n");
-			return;
-		}
+		const ofp_flow_stats* flow_stats = reinterpret_cast<const ofp_flow_stats*>(body.data());
 
 		// Process length of current entry -- handle end of ptr
 		size_t flow_length = ntohs(flow_stats->length);
-		if (flow_length == 0 || flow_length > body_size) {
+		if (flow_length == 0 || flow_length > body.size()) {
 			break;
 		}
 
-		// Cast ptr to access ofp_action_header struct
-		ofp_action_header* action_header = reinterpret_cast<ofp_action_header*>(flow_stats->actions);
-		if (action_header == nullptr) {
-			loggyErr("[CCPDN-ERROR]: Couldn't read actions from stats reply.\n");
-			return;
+		// Entry without an output action -- nothing to map a next hop from
+		if (flow_length < min_entry_size) {
+			body = body.subspan(flow_length);
+			continue;
 		}
 
+		// Cast ptr to access ofp_action_header struct
+		const ofp_action_header* action_header = reinterpret_cast<const ofp_action_header*>(body.data() + sizeof(ofp_flow_stats));
+
 		// Flow processing
 		uint32_t rulePrefixIP = ntohl(flow_stats->match.nw_src);
 		uint32_t wildcards = ntohl(flow_stats->match.wildcards);
 		uint16_t output_port = ntohs(action_header->port);
 
 		// Create string formats
-		std::string targetSwitch = getSrcFromXID(reply->header.xid);
+		std::string targetSwitch = getSrcFromXID(xid);
 		std::string nextHop = getIPFromOutputPort(targetSwitch, output_port);
 		std::string rulePrefix = OpenFlowMessage::getRulePrefix(wildcards, rulePrefixIP);
 
 		// If we don't have a valid next hop (not mapped) but our target switch is a domain node, set the next hop as "xxx.xxx.xxx.xxx"
-		if (nextHop == "-1" && referenceTopology->getNodeByIP(targetSwitch).isDomainNode()) {
+		if (nextHop == "-1" && referenceTopology->getNodeView(targetSwitch).isDomainNode()) {
 			nextHop = "xxx.xxx.xxx.xxx";
 		}
 
-		// Add flow to shared flows
-		recvSharedFlag = false;
+		// Hand the entry to retrieveFlows -- listed flows aren't mods, so the flow handler has no use for them
 		Flow f = Flow(targetSwitch, rulePrefix, nextHop, true);
 		f.setMod(false);
-		{
-			std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-			sharedFlows.push_back(f);
-		}
-
-		// Set fhFlag if we are expecting this as a list-flows return
-		if (reply->header.xid == fhXID) {
-			fhXID = -1;
-			fhFlag = true;
-		}
+		flowListReplies.push(f);
 
 		// Move to next entry
-		offset += flow_length;
-		body_size -= flow_length;
+		body = body.subspan(flow_length);
+	}
+
+	// Set fhFlag once the whole reply is in if we are expecting this as a list-flows return
+	if (fhXIDPending && xid == fhXID) {
+		fhXIDPending = false;
+		fhFlag = true;
 	}
 #endif
 }
 
-void Controller::handleFlowMod(ofp_flow_mod *mod)
+void Controller::handleFlowMod(const OpenFlowView& msg)
 {
-	// Null check
+	// Null check -- also rejects messages shorter than an ofp_flow_mod
+	const ofp_flow_mod* mod = msg.flowMod();
 	if (mod == nullptr) {
 		return;
 	}
 
 #ifdef __unix__
-	// Fix endianness on header, look at header
-	mod->header.length = ntohs(mod->header.length);
-	mod->header.xid = ntohl(mod->header.xid);
-
-	// Ensure our packet matches the minimum size of an ofp_flow_mod
-	if (mod->header.length < sizeof(ofp_flow_mod)) {
-		return;
-	}
+	uint32_t xid = msg.xid();
 
 	// Flow processing
 	uint32_t rulePrefixIP = ntohl(mod->match.nw_src);
 	uint32_t wildcards = ntohl(mod->match.wildcards);
-	bool command = mod->command == OFPFC_ADD ? true : false;
-	bool flow_mod = mod->command == (OFPFC_MODIFY || OFPFC_MODIFY_STRICT) ? true : false;
+	bool command = ntohs(mod->command) == OFPFC_ADD ? true : false;
 
 	// Create string formats
-	std::string targetSwitch = getSrcFromXID(mod->header.xid);
-	std::string nextHop = getDstFromXID(mod->header.xid);
+	std::string targetSwitch = getSrcFromXID(xid);
+	std::string nextHop = getDstFromXID(xid);
 	std::string rulePrefix = OpenFlowMessage::getRulePrefix(wildcards, rulePrefixIP);
 
 	// Check if the flow rule is valid
@@ -2270,47 +3102,37 @@ void Controller::handleFlowMod(ofp_flow_mod *mod)
 	}
 	
 	// Add flow to shared flows -- since it is added, do true
-	recvSharedFlag = false;
 	Flow f = Flow(targetSwitch, rulePrefix, nextHop, command);
 	f.setMod(true);
 	
 	// If we are expecting this flow, set the flag to true
-	if (mod->header.xid == expFlowXID) {
-		expFlowXID = -1;
+	if (expFlowXIDPending && xid == expFlowXID) {
+		expFlowXIDPending = false;
 		gotFlowMod = true;
 	}
 
-	{
-		std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-		sharedFlows.push_back(f);
-	}
+	pushSharedFlow(f);
 #endif
 }
 
-void Controller::handleFlowRemoved(ofp_flow_removed *removed)
+void Controller::handleFlowRemoved(const OpenFlowView& msg)
 {
-	// Null check
+	// Null check -- also rejects messages shorter than an ofp_flow_removed
+	const ofp_flow_removed* removed = msg.flowRemoved();
 	if (removed == nullptr) {
 		return;
 	}
 
 #ifdef __unix__
-	// Fix endianness on header, look at header
-	removed->header.length = ntohs(removed->header.length);
-	removed->header.xid = ntohl(removed->header.xid);
-
-	// Ensure our packet matches the minimum size of an ofp_flow_removed
-	if (removed->header.length < sizeof(ofp_flow_removed)) {
-		return;
-	}
+	uint32_t xid = msg.xid();
 
 	// Flow processing
 	uint32_t rulePrefixIP = ntohl(removed->match.nw_src);
 	uint32_t wildcards = ntohl(removed->match.wildcards);
 
 	// Create string formats
-	std::string targetSwitch = getSrcFromXID(removed->header.xid);
-	std::string nextHop = getDstFromXID(removed->header.xid);
+	std::string targetSwitch = getSrcFromXID(xid);
+	std::string nextHop = getDstFromXID(xid);
 	std::string rulePrefix = OpenFlowMessage::getRulePrefix(wildcards, rulePrefixIP);
 
 	// Check if the flow rule is valid
@@ -2320,13 +3142,9 @@ void Controller::handleFlowRemoved(ofp_flow_removed *removed)
 	}
 
 	// Add flow to shared flows -- since it is added, do true
-	// recvSharedFlag = false;
 	Flow f = Flow(targetSwitch, rulePrefix, nextHop, false);
 	f.setMod(true);
-	{
-		std::lock_guard<std::mutex> lock(sharedFlowsMutex);
-		sharedFlows.push_back(f);
-	}
+	pushSharedFlow(f);
 #endif
 }
 
@@ -2345,7 +3163,7 @@ std::string Controller::readBuffer(char* buf)
 
 void Controller::testVerificationTime(int numFlows, bool interTopology) {
     std::vector<std::string> switchIPs;
-    for (Node n : referenceTopology->getTopology(referenceTopology->hostIndex)) {
+    for (const Node& n : referenceTopology->getTopology(referenceTopology->hostIndex)) {
         if (n.isSwitch() && switchIPs.size() < 5) {
             switchIPs.push_back(n.getIP());
         }
@@ -2353,7 +3171,7 @@ void Controller::testVerificationTime(int numFlows, bool interTopology) {
 
 	std::vector<std::string> separateTopologyIPs;
 	if (interTopology) {
-		for (Node n : referenceTopology->getTopology(referenceTopology->hostIndex + 1)) {
+		for (const Node& n : referenceTopology->getTopology(referenceTopology->hostIndex + 1)) {
 			if (n.isSwitch() && separateTopologyIPs.size() < 5) {
 				separateTopologyIPs.push_back(n.getIP());
 			}
@@ -2384,8 +3202,7 @@ void Controller::testVerificationTime(int numFlows, bool interTopology) {
 		if (interTopology) {
 			std::string sepTopologySwitch = "";
 			for (int j = 0; j < separateTopologyIPs.size(); j++) {
-				Node n = referenceTopology->getNodeByIP(separateTopologyIPs[j]);
-				if (!n.isDomainNode()) {
+				if (!referenceTopology->getNodeView(separateTopologyIPs[j]).isDomainNode()) {
 					sepTopologySwitch = separateTopologyIPs[j];
 					break;
 				}
@@ -2405,7 +3222,7 @@ void Controller::testVerificationTime(int numFlows, bool interTopology) {
 	if (!interTopology) {
 		for (Flow& flow : testFlows) {
 			auto start = std::chrono::high_resolution_clock::now();
-			performVerification(false, flow);
+			performVerification(flow);
 			auto end = std::chrono::high_resolution_clock::now();
 			std::chrono::duration<double> duration = end - start;
 			verificationTimes.push_back(duration.count());
@@ -2426,7 +3243,7 @@ void Controller::testVerificationTime(int numFlows, bool interTopology) {
 	for (Flow f : inverseFlows) {
 		if (!interTopology) {
 			// Remove the flow from the topology
-			performVerification(false, f);
+			performVerification(f);
 		} else {
 			// Remove the flow from the topology
 			remapVerify(f);
@@ -2475,26 +3292,38 @@ void Controller::closeSockets()
     }
 }
 
-void Controller::mapSocketToIndex(int* socket, int index)
+void Controller::mapPeerToIndex(const CCPDNPeerHandle& peer, int index)
 {
-	// Map the socket to the index in the socketMap
-	socketTopologyMap[index] = socket;
+	// Map the index to the peer's connection
+	std::lock_guard<std::mutex> lock(ccpdnMutex);
+	socketTopologyMap[index] = peer;
+	peer->topologyIndex = index;
+
+	// A new connection may be a restarted instance, it holds none of what we sent the old one
+	peerTopologyVersions.erase(index);
 }
 
-int* Controller::getSocketFromIndex(int index)
+CCPDNPeerHandle Controller::getPeer(int index)
 {
-	// Check if the index exists in the socketMap
-	if ((socketTopologyMap.find(index) != socketTopologyMap.end()) && index != referenceTopology->hostIndex) {
-		return socketTopologyMap[index];
+	// Look the peer up on every use -- a handle held across a reconnect refers to the old, closed connection
+	std::lock_guard<std::mutex> lock(ccpdnMutex);
+	auto it = socketTopologyMap.find(index);
+	if (it != socketTopologyMap.end() && index != referenceTopology->hostIndex) {
+		return it->second;
 	}
 
 	return nullptr;
 }
 
+bool Controller::isPeerConnected(int index)
+{
+	return getPeer(index) != nullptr;
+}
+
 bool Controller::validateFlow(Flow f)
 {
 	// Don't allow duplicates
-	if (f.getSwitchIP() == f.getNextHopIP()) {
+	if (f.isSelfLoop()) {
 		return false;
 	}
 
@@ -2507,16 +3336,12 @@ bool Controller::validateFlow(Flow f)
 		return false;
 	}
 
-	// Get links for SrcIP -- only need to check one nodes links
-	std::vector<std::string> srcLinks = referenceTopology->getNodeByIP(f.getSwitchIP()).getLinks();
-	if (srcLinks.empty()) { return false; }
+	// Check SrcIP's links -- only need to check one nodes links
+	if (!referenceTopology->isLinked(f.getSwitchIP(), f.getNextHopIP())) { return false; }
 
 	// Only allow domain nodes to be added as next hops with inter-domain links
-	for (std::string link : srcLinks) {
-		if ((link == f.getNextHopIP() && referenceTopology->getNodeByIP(link).isDomainNode())
-		|| (link == f.getNextHopIP() && referenceTopology->getNodeByIP(f.getSwitchIP()).isDomainNode())) {
-			return true;
-		}
+	if (referenceTopology->getNodeView(f.getNextHopIP()).isDomainNode() || referenceTopology->getNodeView(f.getSwitchIP()).isDomainNode()) {
+		return true;
 	}
 	
 	// Nothing found -- not valid
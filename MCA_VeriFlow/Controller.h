@@ -8,6 +8,13 @@
 #include "Log.h"
 #include "Topology.h"
 #include "TCPAnalyzer.h"
+#include "PendingRequests.h"
+#include "ExpiringSet.h"
+#include "DoubleBuffer.h"
+#include "ControlFlag.h"
+#include "FrameBuffer.h"
+#include "CCPDNPeer.h"
+#include "InterfaceTable.h"
 #include <iostream>
 #include <vector>
 #include <string>
@@ -20,66 +27,123 @@
 #include <thread>
 #include <utility>
 #include <unordered_map>
+#include <future>
+#include <unordered_set>
 
 #ifdef __unix__
 	#include <sys/socket.h>
 	#include <arpa/inet.h>
 	#include <unistd.h>
+	#include <sys/uio.h>
+	#include <poll.h>
 #endif
+#ifdef __linux__
+	#include <sys/epoll.h>
+#endif
+
+// getDPID result for a switch whose DPID couldn't be resolved
+#define DPID_NONE UINT64_MAX
+// Length-prefixed framing version (advertised in the connection greeting, frames are NUL-terminated until both sides switch)
+#define CCPDN_FRAMING_VERSION 1
+// Topology delta sync version (advertised in the connection greeting)
+#define TOPOLOGY_DELTA_VERSION 1
+// Most socket events the CCPDN reactor handles per epoll_wait()
+#define CCPDN_MAX_EVENTS 64
+// Most bytes read from a CCPDN socket per recv() -- frames larger than this are reassembled across reads
+#define CCPDN_RECV_CHUNK_SIZE 65536
+// How often the CCPDN reactor and request worker wake with nothing to do, only used to notice the service stopping
+#define CCPDN_REACTOR_TIMEOUT_MS 1000
+// How long to wait for another CCPDN instance to answer a verification request
+#define CCPDN_VERIFY_TIMEOUT_MS 900
+// How long to wait for other CCPDN instances to return a flow list
+#define CCPDN_FLOW_LIST_TIMEOUT_MS 500
+// How long to wait for the flow handler to answer a listflows request
+#define FLOW_LIST_REPLY_TIMEOUT_MS 900
+// Peer heartbeat version (advertised in the connection greeting)
+#define CCPDN_HEARTBEAT_VERSION 1
+// How often the peer manager runs (heartbeats, dead peer checks, reconnects)
+#define CCPDN_PEER_TICK_MS 250
+// How often a heartbeat is sent to a quiet peer
+#define CCPDN_HEARTBEAT_MS 1000
+// How long a heartbeating peer can stay silent before its connection is dropped
+#define CCPDN_PEER_TIMEOUT_MS 3500
+// Longest a send to a peer may block -- a peer that stops reading is treated as gone
+#define CCPDN_SEND_TIMEOUT_MS 500
+// First and largest delay between reconnect attempts to a lost peer (doubled after each failure)
+#define CCPDN_RECONNECT_MIN_MS 500
+#define CCPDN_RECONNECT_MAX_MS 30000
+// How long a flow CCPDN installed itself stays on the ignore list waiting for its echo
+#define FLOW_IGNORE_TTL_MS 5000
 
 class Controller {
 	public:
-		static bool pauseOutput;
-		static std::mutex sharedFlowsMutex;
+		static ControlFlag pauseOutput;
+		static std::mutex ccpdnMutex;
 
 		// Constructors and destructors
 		Controller();
 		Controller(Topology* t);
 		~Controller();
 
+		// Threads hold a pointer to the controller and its locks, so it is never copied
+		Controller(const Controller&) = delete;
+		Controller& operator=(const Controller&) = delete;
+
 		// Setters
+		void setTopology(Topology* t);
+
 		void setControllerIP(std::string Controller_IP, std::string Controller_Port);
 		void setVeriFlowIP(std::string VeriFlow_IP, std::string VeriFlow_Port);
 		void setFlowHandlerIP(std::string fh_IP, std::string fh_Port);
 
 		// Controller setup/freeing functions
-		bool startController(bool* thread);
-		bool startFlow(bool* thread);
+		bool startController(std::atomic<bool>* thread);
+		bool startFlow(std::atomic<bool>* thread);
 		bool start();
 		bool freeLink();
 
 		// Thread loop functions
-		void controllerThread(bool* run);
-		void flowHandlerThread(bool* run);
-		void CCPDNServerThread(int port, bool* run);
-		void CCPDNThread(bool* run);
+		void controllerThread(std::atomic<bool>* run);
+		void flowHandlerThread(std::atomic<bool>* run);
+		void CCPDNServerThread(int port, std::atomic<bool>* run);
+		void CCPDNPeerThread(std::atomic<bool>* run);
+		void CCPDNRequestThread(std::atomic<bool>* run);
 
 		// CCPDN communication funcs
 		bool initCCPDN();
 		bool stopCCPDNServer();
-		void closeAcceptedSocket(int socket);
+		void closePeer(const CCPDNPeerHandle& peer);
 
 		// Reading + Parsing functions
-		bool parsePacket(std::vector<uint8_t>& packet, bool xidCheck);
+		bool parsePacket(std::span<const uint8_t> packet, bool xidCheck);
 		std::vector<uint8_t> recvControllerMessages();
 		void recvVeriFlowMessages();
 		void recvProcessCCPDN(int socket);
+		void handlePeerRequest(Digest& request);
 		void parseFlow(Flow f);
+		bool isLocalVerification(Flow f);
+		void verifyFlowBatch(std::vector<Flow> flows);
 
 		// OpenFlow packet decode functions
-		void handleStatsReply(ofp_stats_reply* reply);
-		void handleFlowMod(ofp_flow_mod* mod);
-		void handleFlowRemoved(ofp_flow_removed* removed);
+		void handleStatsReply(const OpenFlowView& msg);
+		void handleFlowMod(const OpenFlowView& msg);
+		void handleFlowRemoved(const OpenFlowView& msg);
 
 		// Send msg functions
 		bool sendOpenFlowMessage(std::vector<unsigned char> data);
+		bool sendOpenFlowMessage(std::span<const unsigned char> data);
 		bool sendVeriFlowMessage(std::string message);
 		bool sendFlowHandlerMessage(std::string message);
-		bool sendCCPDNMessage(int socket, std::string message);
+		bool sendFlowInstall(Flow f, bool add, int XID);
+		bool sendFlowHandlerFrame(std::string dpid, std::span<const unsigned char> data);
+		bool sendCCPDNMessage(const CCPDNPeerHandle& peer, std::string message);
+		bool sendCCPDNDigest(const CCPDNPeerHandle& peer, Digest& digest);
 
 		// Update functions
 		bool synchTopology(Digest d);
-		bool sendUpdate(bool global, int destinationIndex);
+		// knownVersion is the destination's version of our topology, used to send only the changes since
+		bool sendUpdate(bool global, int destinationIndex, uint64_t knownVersion = TOPOLOGY_VERSION_UNKNOWN);
+		bool requestUpdate(int index);
 
 		// Flow functions
 		bool addFlowToTable(Flow f);
@@ -95,17 +159,21 @@ class Controller {
 
 		// Verification functions
 		bool requestVerification(int destinationIndex, Flow f);
-		bool performVerification(bool externalRequest, Flow f);
+		std::future<bool> requestVerificationAsync(int destinationIndex, Flow f, uint32_t* requestID = nullptr);
+		bool performVerification(Flow f);
+		std::vector<bool> performBatchVerification(std::vector<Flow> flows);
 		bool undoVerification(Flow f, int topologyIndex);
 		bool modifyFlowTableWithoutVerification(Flow f, bool success);
 
 		// All funcs related to external verification
 		bool remapVerify(Flow newFlow);
 		std::vector<std::string> getLinkPathToNode(std::string srcIP, std::string dstIP);
-		std::vector<Flow> getRelatedFlows(std::string IP); //Unused
-		std::vector<Flow> filterFlows(std::vector<Flow> flows, std::string domainNodeIP, int topologyIndex); //Unused
+		// Every flow whose next hop is IP, from its own topology and the ones around it (not wired to a command yet)
+		std::vector<Flow> getRelatedFlows(std::string IP);
+		// Flows that stay within topologyIndex or leave it through domainNodeIP (used by the CLI filter test)
+		std::vector<Flow> filterFlows(std::vector<Flow> flows, std::string domainNodeIP, int topologyIndex);
 		std::vector<std::vector<Flow>> translateFlows(std::vector<Flow> flows, std::string originalIP, std::string newIP);
-		Node getBestDomainNode(int firstIndex, int secondIndex);
+		const Node* getBestDomainNode(int firstIndex, int secondIndex);
 
 		// Get link/interface funcs
 		int getNumLinks(std::string IP, bool Switch);
@@ -114,70 +182,121 @@ class Controller {
 		int getPortFromMap(std::string srcIP, std::string dstIP);
 		void addIPToMap(std::string srcIP, int port, std::string dstIP);
 		std::string getIPFromMap(std::string srcIP, int port);
+		void addDPIDToMap(std::string IP, uint64_t dpid);
+		uint64_t getDPIDFromMap(std::string IP);
+		void clearDPIDMap();
+		void loadDPIDs();
 
 		// Misc functions
 		bool 			   addDomainNode(Node* n);
 		std::vector<Node*> getDomainNodes();
 		void 			   rstControllerFlag();
 		void 			   rstVeriFlowFlag();
-		int	 			   getDPID(std::string IP);
+		uint64_t		   getDPID(std::string IP);
 		int  			   getOutputPort(std::string srcIP, std::string dstIP);
 		std::string		   getIPFromOutputPort(std::string srcIP, int outputPort);
-		void			   tryClearSharedFlows();
+		void			   pushSharedFlow(Flow f);
 		void               testVerificationTime(int numFlows, bool interTopology);
 		void			   closeSockets();
-		void			   mapSocketToIndex(int* socket, int index);
-		int*			   getSocketFromIndex(int index);
+		void			   mapPeerToIndex(const CCPDNPeerHandle& peer, int index);
+		// Current connection to a topology index, null if that instance isn't connected right now
+		CCPDNPeerHandle	   getPeer(int index);
+		bool			   isPeerConnected(int index);
 		bool			   validateFlow(Flow f);
 
 		// Map every XID to a flow, specifically the source and destination IPs
 		std::unordered_map<uint32_t, std::pair<std::string, std::string>> xidFlowMap; 
-		// Map each connection (socket) to the corresponding topology index
-		std::unordered_map<int, int*> socketTopologyMap;
+		// Map each topology index to its current connection (guarded by ccpdnMutex)
+		std::unordered_map<int, CCPDNPeerHandle> socketTopologyMap;
 		// Map each (srcSwitch, dstSwitch) -> outputPort pair
 		std::unordered_map<std::string, int> portMap;
 		std::unordered_map<std::string, std::string> portMapReverse;
+		// Map each switch IP -> DPID (filled by loadDPIDs, cleared when the host topology changes)
+		std::unordered_map<std::string, uint64_t> dpidMap;
+		std::mutex dpidMapMutex;
 
 		std::string				  controllerPort;
 		std::string				  veriflowPort;
 		std::string				  flowPort;
-		std::vector<Flow>		  sharedFlows;
+		// Flow mods/removals for the flow handler, drained in whole batches
+		DoubleBuffer<Flow>		  sharedFlows;
+		// Flow stats reply entries for retrieveFlows
+		DoubleBuffer<Flow>		  flowListReplies;
 		std::vector<uint8_t>	  sharedPacket;
-		bool					  fhFlag;
-		int						  fhXID;
-		int						  expFlowXID;
-		bool					  gotFlowMod;
-		bool					  recvSharedFlag;
+		// Raised once the stats reply to a listflows request has been read
+		ControlFlag				  fhFlag;
+		// XIDs of the listflows request and flow install being waited on, only meaningful while their pending flag is raised
+		// (the flag is set after the XID, so a thread that sees it raised also sees the XID)
+		uint32_t				  fhXID;
+		ControlFlag				  fhXIDPending;
+		uint32_t				  expFlowXID;
+		ControlFlag				  expFlowXIDPending;
+		ControlFlag				  gotFlowMod;
 		int						  basePort;
-		std::vector<Flow>		  CCPDN_FLOW_RESPONSE;
-		std::vector<Flow>		  CCPDN_FLOW_FAIL;
-		std::vector<Flow>		  CCPDN_FLOW_SUCCESS;
-		bool					  ALLOW_CCPDN_RECV;
-		std::vector<Flow>		  ignoreFlows;
+		// Verification requests awaiting a reply from another CCPDN instance
+		PendingRequests<bool>	  pendingVerifications;
+		// Flow list requests awaiting a reply from another CCPDN instance
+		PendingRequests<std::vector<Flow>> pendingFlowLists;
+		// Verification and flow list requests from other CCPDN instances, queued by the reactor for the request worker
+		DoubleBuffer<Digest>	  peerRequests;
+		ControlFlag				  peerRequestsReady;
+		// Flows CCPDN installed itself, skipped once when they show up again
+		ExpiringSet<Flow>		  ignoreFlows{std::chrono::milliseconds(FLOW_IGNORE_TTL_MS)};
+		// Encode flow mods locally and have the FlowInterface forward them as-is (instead of text commands)
+		bool					  directFlowInstall;
 
 	private:
 		int						  sockfd;
 		int						  sockvf;
 		int						  sockfh;
 		int						  sockCC;
-		std::vector<int>		  acceptedCC;
+		// CCPDN reactor -- watches sockCC and every socket in ccpdnPeers (both guarded by ccpdnMutex)
+		int						  epollCC;
+		// Every connected CCPDN socket and what we know about its peer (guarded by ccpdnMutex)
+		std::unordered_map<int, CCPDNPeerHandle> ccpdnPeers;
+		// Reconnect schedule for each instance we're responsible for connecting to (guarded by ccpdnMutex)
+		std::unordered_map<int, CCPDNBackoff> ccpdnReconnects;
+		// Version of our topology last sent to each instance (guarded by ccpdnMutex)
+		std::unordered_map<int, uint64_t> peerTopologyVersions;
 		std::string				  controllerIP;
 		std::string				  veriflowIP;
 		std::string				  flowIP;
 		std::vector<Node*>		  domainNodes;
 		Topology*				  referenceTopology;
 		char					  vfBuffer[1024];
-		bool					  vfFlag;
-		bool					  ofFlag;
-		bool					  pause_rst;
-		bool					  noRst;
-		bool					  forceStopShared;
+		// Held for each whole write to sockfh -- the flow handler, request worker and CLI all send to the FlowInterface
+		std::mutex				  flowHandlerMutex;
+		// Held for a whole request/response exchange on sockvf -- the CCPDN request worker and the flow handler both verify
+		std::mutex				  veriflowMutex;
+		// Shared between the controller, flow handler and CCPDN threads
+		ControlFlag				  vfFlag;
+		ControlFlag				  ofFlag;
+		ControlFlag				  pause_rst;
+		ControlFlag				  noRst;
 
 		// Private Functions
 		bool linkVeriFlow();
 		bool linkController();
 		bool linkFlow();
+		std::string getInterfaceName(std::string IP);
+#ifdef __unix__
+		// Write every byte of parts to sockfh (advancing parts), false on a send error
+		bool writeFlowHandler(iovec* parts, int count);
+#endif
+		uint64_t resolveDPID(std::string IP);
 		void veriFlowHandshake();
+		CCPDNPeerHandle addCCPDNSocket(int socket, bool outbound);
+		bool connectCCPDN(int index);
+		void enablePeerOption(const CCPDNPeerHandle& peer, bool CCPDNPeer::* option);
+		// True if the socket has data waiting (or a hangup) the reactor hasn't read yet
+		bool isReadable(int socket);
+		// Write one frame with no logging or error handling (heartbeats go through here)
+		bool sendCCPDNFrame(CCPDNPeer& peer, const std::string& message);
+		bool writeCCPDNFrame(int socket, const std::vector<uint8_t>& frame);
+		// Send our framing marker (once) and length-prefix every frame after it, false if the peer is gone
+		bool startLengthFraming(const CCPDNPeerHandle& peer);
+		bool sendTopology(int destinationIndex, uint64_t knownVersion, bool skipIfCurrent);
+		void acceptCCPDNConnections();
 		std::string readBuffer(char* buf);
 };
 
@@ -5,7 +5,8 @@
 Digest::Digest(bool synch, bool update, bool verification, 
     int hIndex, int dIndex, const std::string& data)
     : synch_bit(synch), update_bit(update), verification_bit(verification),
-      hostIndex(hIndex), destinationIndex(dIndex), payload(data) { }
+      hostIndex(hIndex), destinationIndex(dIndex), payload(data), requestID(0),
+      kind(kindFromBits(synch, update, verification)) { }
 
 // Destructor
 Digest::~Digest()
@@ -26,10 +27,11 @@ std::string Digest::toJson() {
     j["destinationIndex"] = destinationIndex;
     j["payload"] = payload;
     j["flow_data"] = flowString;
+    j["request_id"] = requestID;
     return j.dump();
 }
 
-void Digest::fromJson(const std::string& json_str) {
+bool Digest::fromJson(const std::string& json_str) {
     try {
         nlohmann::json j = nlohmann::json::parse(json_str);
         std::string flow_data = "";
@@ -42,64 +44,140 @@ void Digest::fromJson(const std::string& json_str) {
         payload = j["payload"].get<std::string>();
         flow_data = j["flow_data"].get<std::string>();
         appendedFlow = Flow::strToFlow(flow_data);
+        requestID = j.value("request_id", 0u);
+        kind = kindFromBits(synch_bit, update_bit, verification_bit);
+        return true;
 
     } catch (const std::exception& e) {
         loggyErr("JSON parsing error: ");
         loggyErr(e.what());
         loggyErr("\n");
+        kind = INVALID;
+        return false;
     }
 }
 
-int Digest::readDigest(const std::string& data) {
-    try {
-        nlohmann::json j = nlohmann::json::parse(data);
-        
-        if (!j.contains("synch_bit") || !j.contains("update_bit") || 
-            !j.contains("verification_bit")) {
-            return -1;
-        }
-
-        bool synch = j["synch_bit"].get<int>() == 1;
-        bool update = j["update_bit"].get<int>() == 1;
-        bool verification = j["verification_bit"].get<int>() == 1;
-
-        if (synch && !update && !verification) { // 100 -- topology update (new master)
-            return 0;
-        } 
-        else if (!synch && update && !verification) { // 010 -- synchronize topology (applying update from master)
-            return 1;
-        }
-        else if (!synch  && !update && verification) { // 001 -- perform verification
-            return 2;
-        }
-        else if (!synch && update && verification) { // 011 -- verification success
-            return 3;
-        }
-        else if (synch && update && verification) { // 111 -- verification fail
-            return 4;
-        }
-        else if (!synch && !update && !verification) { // 000 -- requesting flow list from payload
-            return 5;
-        }
-        else if (synch && update && !verification) { // 110 -- flow list attached to payload
-            return 6;
-        }
-        else {
-            return -1;
-        }
+// Big-endian field helpers for the binary form
+static void putUint32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
 
-    } catch (const std::exception& e) {
-        std::cerr << "Digest parsing error: " << e.what() << std::endl;
-        return -1;
+static uint32_t getUint32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16)
+        | (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+// Bits byte of the binary form
+#define DIGEST_BIT_SYNCH 0x01
+#define DIGEST_BIT_UPDATE 0x02
+#define DIGEST_BIT_VERIFICATION 0x04
+#define DIGEST_BIT_FLOW 0x08
+
+std::string Digest::toBinary() {
+    bool hasFlow = !appendedFlow.isEmptyFlow();
+
+    std::string out;
+    out.reserve(DIGEST_BINARY_HEADER_SIZE + (hasFlow ? Flow::PACKED_SIZE : 0) + 4 + payload.size());
+    out.push_back(static_cast<char>(DIGEST_BINARY_MAGIC));
+    out.push_back(static_cast<char>(DIGEST_BINARY_VERSION));
+    out.push_back(static_cast<char>((synch_bit ? DIGEST_BIT_SYNCH : 0) | (update_bit ? DIGEST_BIT_UPDATE : 0)
+        | (verification_bit ? DIGEST_BIT_VERIFICATION : 0) | (hasFlow ? DIGEST_BIT_FLOW : 0)));
+    out.push_back(0);
+    putUint32(out, static_cast<uint32_t>(hostIndex));
+    putUint32(out, static_cast<uint32_t>(destinationIndex));
+    putUint32(out, requestID);
+
+    if (hasFlow) {
+        uint8_t packed[Flow::PACKED_SIZE];
+        appendedFlow.pack(packed);
+        out.append(reinterpret_cast<const char*>(packed), sizeof(packed));
     }
+
+    putUint32(out, static_cast<uint32_t>(payload.size()));
+    out += payload;
+    return out;
 }
 
-Flow Digest::getFlow(const std::string &raw_data)
-{
-    nlohmann::json j = nlohmann::json::parse(raw_data);
-    std::string parsedFlow = j["flow_data"].get<std::string>();
+bool Digest::fromBinary(const std::string& data) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+    size_t size = data.size();
+
+    kind = INVALID;
+    if (size < DIGEST_BINARY_HEADER_SIZE + 4 || in[0] != DIGEST_BINARY_MAGIC || in[1] != DIGEST_BINARY_VERSION) {
+        loggyErr("Binary digest error: bad header\n");
+        return false;
+    }
 
-    return Flow::strToFlow(parsedFlow);
+    uint8_t bits = in[2];
+    size_t offset = DIGEST_BINARY_HEADER_SIZE;
+    if ((bits & DIGEST_BIT_FLOW) && size < offset + Flow::PACKED_SIZE + 4) {
+        loggyErr("Binary digest error: truncated flow\n");
+        return false;
+    }
+
+    synch_bit = bits & DIGEST_BIT_SYNCH;
+    update_bit = bits & DIGEST_BIT_UPDATE;
+    verification_bit = bits & DIGEST_BIT_VERIFICATION;
+    hostIndex = static_cast<int32_t>(getUint32(in + 4));
+    destinationIndex = static_cast<int32_t>(getUint32(in + 8));
+    requestID = getUint32(in + 12);
+
+    appendedFlow = Flow();
+    if (bits & DIGEST_BIT_FLOW) {
+        appendedFlow = Flow::unpack(in + offset);
+        offset += Flow::PACKED_SIZE;
+    }
+
+    uint32_t payloadLength = getUint32(in + offset);
+    offset += 4;
+    if (size - offset < payloadLength) {
+        loggyErr("Binary digest error: truncated payload\n");
+        return false;
+    }
+    payload.assign(data, offset, payloadLength);
+    kind = kindFromBits(synch_bit, update_bit, verification_bit);
+    return true;
+}
+
+bool Digest::isBinary(const std::string& raw_data) {
+    return !raw_data.empty() && static_cast<uint8_t>(raw_data[0]) == DIGEST_BINARY_MAGIC;
+}
+
+bool Digest::decode(const std::string& raw_data) {
+    if (isBinary(raw_data)) {
+        return fromBinary(raw_data);
+    }
+    return fromJson(raw_data);
+}
+
+Digest::Kind Digest::kindFromBits(bool synch, bool update, bool verification) {
+    if (synch && !update && !verification) { // 100 -- topology update (new master)
+        return TOPOLOGY_UPDATE_MASTER;
+    } 
+    else if (!synch && update && !verification) { // 010 -- synchronize topology (applying update from master)
+        return TOPOLOGY_UPDATE_SYNC;
+    }
+    else if (!synch  && !update && verification) { // 001 -- perform verification
+        return PERFORM_VERIFICATION_REQ;
+    }
+    else if (!synch && update && verification) { // 011 -- verification success
+        return VERIFICATION_SUCCESS;
+    }
+    else if (synch && update && verification) { // 111 -- verification fail
+        return VERIFICATION_FAIL;
+    }
+    else if (!synch && !update && !verification) { // 000 -- requesting flow list from payload
+        return FLOW_LIST_REQUEST;
+    }
+    else if (synch && update && !verification) { // 110 -- flow list attached to payload
+        return FLOW_LIST_RESPONSE;
+    }
+    else {
+        return INVALID;
+    }
 }
 
 void Digest::appendFlow(Flow f)
@@ -111,17 +189,13 @@ Flow Digest::getFlow() {
 	return appendedFlow;
 }
 
-std::vector<Node> Digest::getTopology(std::string message)
+std::vector<Node> Digest::getTopology()
 {
-    // Parse payload string from msg
-    nlohmann::json j = nlohmann::json::parse(message);
-    std::string parsedTop = j["payload"].get<std::string>();
-
-    if (parsedTop.empty()) {
+    if (payload.empty()) {
         return std::vector<Node>();
     }
 
-    return Topology::string_toTopology(parsedTop);
+    return Topology::string_toTopology(payload);
 }
 
 bool Digest::getSynchBit()
@@ -152,3 +226,11 @@ std::string Digest::getPayload() {
 std::string Digest::getDestinationIP() { 
     return destination_ip; 
 }
+
+uint32_t Digest::getRequestID() {
+    return requestID;
+}
+
+void Digest::setRequestID(uint32_t id) {
+    requestID = id;
+}
@@ -9,7 +9,35 @@
 #include "Flow.h"
 #include "Log.h"
 
+// First byte of a binary digest -- JSON digests always start with '{'
+#define DIGEST_BINARY_MAGIC 0xCD
+// Binary digest format version (advertised in the connection greeting)
+#define DIGEST_BINARY_VERSION 1
+// Magic, version, bits, reserved, hostIndex, destinationIndex, requestID
+#define DIGEST_BINARY_HEADER_SIZE 16
+
+/// Message exchanged between CCPDN instances.
+///
+/// Digests have two encodings: JSON (toJson/fromJson) and a versioned binary form (toBinary/fromBinary)
+/// with fixed-width fields, a packed flow and a length-prefixed payload. Binary is only sent to peers that
+/// advertised it and length-prefixed framing in their greeting (a binary digest can hold NUL bytes, which
+/// end a frame for older instances). decode() accepts either, and older instances keep NUL-delimited JSON,
+/// so mixed deployments keep working.
+
 class Digest {
+public:
+    // What a digest asks for, derived from its three bits once when it is built or decoded
+    enum Kind : int {
+        INVALID = -1,
+        TOPOLOGY_UPDATE_MASTER = 0,     // 100 -- topology update (new master)
+        TOPOLOGY_UPDATE_SYNC = 1,       // 010 -- synchronize topology (applying update from master)
+        PERFORM_VERIFICATION_REQ = 2,   // 001 -- perform verification
+        VERIFICATION_SUCCESS = 3,       // 011 -- verification success
+        VERIFICATION_FAIL = 4,          // 111 -- verification fail
+        FLOW_LIST_REQUEST = 5,          // 000 -- requesting flow list from payload
+        FLOW_LIST_RESPONSE = 6          // 110 -- flow list attached to payload
+    };
+
 private:
     bool synch_bit;
     bool update_bit;
@@ -19,6 +47,11 @@ private:
     std::string payload;
     std::string destination_ip;
     Flow appendedFlow;
+    uint32_t requestID; // Correlates a reply with its request (0 = uncorrelated)
+    Kind kind;
+
+    // Kind for a combination of the three bits (INVALID if unused)
+    static Kind kindFromBits(bool synch, bool update, bool verification);
 
 public:
     Digest(bool synch = false, bool update = false, bool verification = false, 
@@ -27,18 +60,25 @@ public:
 
     // JSON Marshalling methods
     std::string toJson();
-    void fromJson(const std::string& json_str);
+    bool fromJson(const std::string& json_str);
+
+    // Binary Marshalling methods
+    std::string toBinary();
+    bool fromBinary(const std::string& data);
+
+    // Decode either encoding in a single pass, returns false (and kind INVALID) if it is malformed
+    static bool isBinary(const std::string& raw_data);
+    bool decode(const std::string& raw_data);
 
     // Digest methods
-    static int readDigest(const std::string& raw_data);
-    static Flow getFlow(const std::string& raw_data);
+    Kind getKind() const { return kind; }
 
     // Flow methods
     void appendFlow(Flow f);
     Flow getFlow();
 
-    // Topology methods
-    std::vector<Node> getTopology(std::string message);
+    // Topology methods -- parses the payload
+    std::vector<Node> getTopology();
     
     // Misc/getters
     bool getSynchBit();
@@ -48,6 +88,8 @@ public:
     int getDestinationIndex();
     std::string getPayload();
     std::string getDestinationIP();
+    uint32_t getRequestID();
+    void setRequestID(uint32_t id);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef DOUBLEBUFFER_H
+#define DOUBLEBUFFER_H
+
+#include <mutex>
+#include <vector>
+#include <utility>
+
+/// Producer/consumer handoff of batches of values.
+///
+/// Producers append to the back buffer under a short lock. The consumer drains by swapping the whole back
+/// buffer out for its own (emptied) vector, so it gets every value pushed since its last drain -- nothing is
+/// cleared out from under it and nothing pushed during processing is lost. The two vectors trade places
+/// on every drain, so in steady state neither side allocates.
+
+template <typename T>
+class DoubleBuffer {
+	public:
+		DoubleBuffer() {}
+
+		DoubleBuffer(const DoubleBuffer&) = delete;
+		DoubleBuffer& operator=(const DoubleBuffer&) = delete;
+
+		void push(const T& value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			back.push_back(value);
+		}
+
+		// Hand over everything pushed so far, out's old contents are discarded and its storage becomes the new back buffer
+		bool drain(std::vector<T>& out) {
+			out.clear();
+			std::lock_guard<std::mutex> lock(mutex);
+			std::swap(back, out);
+			return !out.empty();
+		}
+
+		bool empty() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return back.empty();
+		}
+
+		void clear() {
+			std::lock_guard<std::mutex> lock(mutex);
+			back.clear();
+		}
+
+	private:
+		mutable std::mutex mutex;
+		std::vector<T> back;
+};
+
+#endif
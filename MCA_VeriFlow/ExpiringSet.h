@@ -0,0 +1,94 @@
+#ifndef EXPIRINGSET_H
+#define EXPIRINGSET_H
+
+#include <chrono>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+
+/// Hashed set whose entries expire a fixed time after they were last inserted.
+///
+/// Used for flows CCPDN installed itself (so the echoed flow mod isn't verified twice). If the echo never
+/// arrives the entry simply ages out instead of sitting in the list forever. Expired entries are swept
+/// once the inserts since the last sweep reach what survived it (at least SWEEP_MIN), so sweeping is
+/// amortised O(1) per insert and the set stays within about twice its live entries.
+
+template <typename T, typename Hash = std::hash<T>>
+class ExpiringSet {
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		explicit ExpiringSet(std::chrono::milliseconds ttl) : ttl(ttl), insertsSinceSweep(0), sweepThreshold(SWEEP_MIN) {}
+
+		ExpiringSet(const ExpiringSet&) = delete;
+		ExpiringSet& operator=(const ExpiringSet&) = delete;
+
+		// Add (or refresh) an entry
+		void insert(const T& value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			Clock::time_point now = Clock::now();
+			entries[value] = now + ttl;
+
+			if (++insertsSinceSweep >= sweepThreshold) {
+				sweep(now);
+			}
+		}
+
+		// True if the entry is present and hasn't expired
+		bool contains(const T& value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = entries.find(value);
+			if (it == entries.end()) {
+				return false;
+			}
+			if (it->second <= Clock::now()) {
+				entries.erase(it);
+				return false;
+			}
+			return true;
+		}
+
+		// Remove an entry, returns true if it was present and hadn't expired
+		bool erase(const T& value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = entries.find(value);
+			if (it == entries.end()) {
+				return false;
+			}
+			bool live = it->second > Clock::now();
+			entries.erase(it);
+			return live;
+		}
+
+		void clear() {
+			std::lock_guard<std::mutex> lock(mutex);
+			entries.clear();
+			insertsSinceSweep = 0;
+			sweepThreshold = SWEEP_MIN;
+		}
+
+		size_t size() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return entries.size();
+		}
+
+	private:
+		static constexpr size_t SWEEP_MIN = 64;
+
+		// Drop every expired entry (caller holds the lock)
+		void sweep(Clock::time_point now) {
+			for (auto it = entries.begin(); it != entries.end();) {
+				it = (it->second <= now) ? entries.erase(it) : std::next(it);
+			}
+			insertsSinceSweep = 0;
+			sweepThreshold = (entries.size() > SWEEP_MIN) ? entries.size() : SWEEP_MIN;
+		}
+
+		mutable std::mutex mutex;
+		std::chrono::milliseconds ttl;
+		std::unordered_map<T, Clock::time_point, Hash> entries;
+		size_t insertsSinceSweep;
+		size_t sweepThreshold;
+};
+
+#endif
@@ -13,23 +13,23 @@ std::vector<std::string> Flow::splitFlowString(std::string flow) {
     return parts;
 }
 
-std::string Flow::flowToStr(bool printDPID)
+std::string Flow::flowToStr(bool printDPID) const
 {
 	// #switchIP-rulePrefix-nextHopIP
 	// or #switchDPID-rulePrefix-outputPort
 	std::string output;
 	std::string actionStr = action ? "A" : "R";
-	std::string outputSrcIP = printDPID ? switchDPID : switchIP;
-	std::string outputHopIP = printDPID ? outPort : nextHopIP;
+	std::string outputSrcIP = printDPID ? (switchDPID ? std::to_string(switchDPID) : "") : getSwitchIP();
+	std::string outputHopIP = printDPID ? (outPort ? std::to_string(outPort) : "") : getNextHopIP();
 	std::string actionPrefix = printDPID ? "" : (actionStr + "#");
-	output = actionPrefix + outputSrcIP + "-" + rulePrefix + "-" + outputHopIP;
+	output = actionPrefix + outputSrcIP + "-" + getRulePrefix() + "-" + outputHopIP;
 	return output;
 }
 
 Flow Flow::strToFlow(std::string payload)
 {
 	// #switchIP-rulePrefix-nextHopIP
-	Flow f = Flow("", "", "", false);
+	Flow f = Flow();
 	
 	// Ensure correct size and format
 	if (payload.size() < 3) {
@@ -61,78 +61,159 @@ Flow Flow::strToFlow(std::string payload)
 
 	// Ensure we parsed something
 	if (swIP.empty() || rulePFX.empty() || nextHIP.empty()) {
-		return Flow("", "", "", false);
+		return Flow();
 	}
 
 	// Set the flow properties
-	f.switchIP = swIP;
-	f.rulePrefix = rulePFX;
-	f.nextHopIP = nextHIP;
+	f.setSwitchIP(swIP);
+	f.setRulePrefix(rulePFX);
+	f.setNextHopIP(nextHIP);
+
+	// Reject flows whose switch or next hop didn't parse rather than pass them on without one
+	if (!f.hasSwitch() || !f.hasNextHop()) {
+		return Flow();
+	}
 
 	return f;
 }
 
-Flow::Flow(std::string SwitchIP, std::string RulePrefix, std::string NextHopIP, bool Action)
+bool Flow::parseIPv4(const std::string& IP, uint32_t& address)
 {
-	switchIP = SwitchIP;
-	rulePrefix = RulePrefix;
-	nextHopIP = NextHopIP;
-	action = Action;
-	isFlowMod = false;
-	switchDPID = "";
-	outPort = "";
-	Modification = false;
+	// Rejects anything that isn't exactly four octets
+	uint32_t result = 0;
+	uint32_t octet = 0;
+	int digits = 0;
+	int dots = 0;
+
+	for (char c : IP) {
+		if (c >= '0' && c <= '9') {
+			octet = octet * 10 + (c - '0');
+			if (++digits > 3 || octet > 255) {
+				return false;
+			}
+		}
+		else if (c == '.' && digits > 0 && dots < 3) {
+			result = (result << 8) | octet;
+			octet = 0;
+			digits = 0;
+			dots++;
+		}
+		else {
+			return false;
+		}
+	}
+
+	if (dots != 3 || digits == 0) {
+		return false;
+	}
+
+	address = (result << 8) | octet;
+	return true;
 }
 
-Flow::Flow()
+std::string Flow::formatIPv4(uint32_t address)
 {
-	switchIP = "";
-	rulePrefix = "";
-	nextHopIP = "";
-	switchDPID = "";
-	outPort = "";
-	action = false;
-	isFlowMod = false;
-	Modification = false;
+	// Longest form is "255.255.255.255"
+	char buffer[16];
+	char* p = buffer;
+	for (int shift = 24; shift >= 0; shift -= 8) {
+		unsigned octet = (address >> shift) & 0xFF;
+		if (octet >= 100) {
+			*p++ = '0' + octet / 100;
+		}
+		if (octet >= 10) {
+			*p++ = '0' + (octet / 10) % 10;
+		}
+		*p++ = '0' + octet % 10;
+		if (shift != 0) {
+			*p++ = '.';
+		}
+	}
+	return std::string(buffer, p - buffer);
 }
 
-Flow::~Flow()
+void Flow::pack(uint8_t* out) const
 {
+	// switchIP, rulePrefix, nextHopIP, prefixLength, then action/prefixBare/hopKind in one byte
+	uint32_t fields[3] = { switchIP, rulePrefix, nextHopIP };
+	for (int i = 0; i < 3; i++) {
+		out[i * 4] = static_cast<uint8_t>(fields[i] >> 24);
+		out[i * 4 + 1] = static_cast<uint8_t>(fields[i] >> 16);
+		out[i * 4 + 2] = static_cast<uint8_t>(fields[i] >> 8);
+		out[i * 4 + 3] = static_cast<uint8_t>(fields[i]);
+	}
+	out[12] = prefixLength;
+	out[13] = static_cast<uint8_t>(action | (prefixBare << 1) | (hopKind << 2));
 }
 
-bool Flow::actionType()
+Flow Flow::unpack(const uint8_t* in)
 {
-	return action;
+	uint32_t fields[3];
+	for (int i = 0; i < 3; i++) {
+		fields[i] = (static_cast<uint32_t>(in[i * 4]) << 24) | (static_cast<uint32_t>(in[i * 4 + 1]) << 16)
+			| (static_cast<uint32_t>(in[i * 4 + 2]) << 8) | in[i * 4 + 3];
+	}
+
+	Flow f;
+	f.switchIP = fields[0];
+	f.rulePrefix = fields[1];
+	f.nextHopIP = fields[2];
+	f.prefixLength = in[12];
+	f.action = in[13] & 0x01;
+	f.prefixBare = (in[13] >> 1) & 0x01;
+	f.hopKind = (in[13] >> 2) & 0x03;
+	if (f.hopKind > HOP_ANY) {
+		f.hopKind = HOP_ADDRESS;
+	}
+	return f;
 }
 
-Flow Flow::inverseFlow()
+Flow::Flow(std::string SwitchIP, std::string RulePrefix, std::string NextHopIP, bool Action) : Flow()
 {
-	Flow inverseFlow = Flow(switchIP, rulePrefix, nextHopIP, !action);
-    return inverseFlow;
+	setSwitchIP(SwitchIP);
+	setRulePrefix(RulePrefix);
+	setNextHopIP(NextHopIP);
+	action = Action;
 }
 
-bool Flow::isMod()
+Flow::Flow()
 {
-    return isFlowMod;
+	switchDPID = 0;
+	switchIP = 0;
+	rulePrefix = 0;
+	nextHopIP = 0;
+	outPort = 0;
+	prefixLength = NO_PREFIX;
+	action = false;
+	isFlowMod = false;
+	Modification = false;
+	prefixBare = false;
+	hopKind = HOP_ADDRESS;
 }
 
-void Flow::setMod(bool mod)
+Flow Flow::inverseFlow() const
 {
-	isFlowMod = mod;
+	Flow inverseFlow = *this;
+	inverseFlow.action = !action;
+	inverseFlow.isFlowMod = false;
+	inverseFlow.Modification = false;
+	inverseFlow.switchDPID = 0;
+	inverseFlow.outPort = 0;
+    return inverseFlow;
 }
 
 void Flow::print()
 {
 	loggyMsg("Switch IP: ");
-	loggyMsg(switchIP);
+	loggyMsg(getSwitchIP());
 	loggyMsg("\n");
 
 	loggyMsg("Rule Prefix: ");
-	loggyMsg(rulePrefix);
+	loggyMsg(getRulePrefix());
 	loggyMsg("\n");
 
 	loggyMsg("Next Hop IP: ");
-	loggyMsg(nextHopIP);
+	loggyMsg(getNextHopIP());
 	loggyMsg("\n");
 
 	loggyMsg("Action: ");
@@ -140,17 +221,89 @@ void Flow::print()
 	loggyMsg("\n");
 }
 
-std::string Flow::getSwitchIP()
+std::string Flow::getSwitchIP() const
+{
+	return switchIP ? formatIPv4(switchIP) : "";
+}
+
+std::string Flow::getRulePrefix() const
 {
-	return switchIP;
+	if (prefixLength == NO_PREFIX) {
+		return "";
+	}
+	if (prefixBare) {
+		return formatIPv4(rulePrefix);
+	}
+	return formatIPv4(rulePrefix) + "/" + std::to_string(prefixLength);
 }
 
-std::string Flow::getRulePrefix()
+std::string Flow::getNextHopIP() const
 {
-	return rulePrefix;
+	switch (hopKind) {
+		case HOP_UNMAPPED:
+			return "-1";
+		case HOP_ANY:
+			return "xxx.xxx.xxx.xxx";
+		default:
+			return nextHopIP ? formatIPv4(nextHopIP) : "";
+	}
 }
 
-std::string Flow::getNextHopIP()
+void Flow::setSwitchIP(const std::string& IP)
 {
-	return nextHopIP;
+	// Only IPv4 switches can be packed -- anything else would quietly read as "no switch", so say so
+	if (!parseIPv4(IP, switchIP) || switchIP == 0) {
+		switchIP = 0;
+		if (!IP.empty()) {
+			loggyErr("[CCPDN-ERROR]: Flow switch " + IP + " is not an IPv4 address, flow has no switch\n");
+		}
+	}
+}
+
+void Flow::setNextHopIP(const std::string& IP)
+{
+	nextHopIP = 0;
+	hopKind = HOP_ADDRESS;
+
+	if (IP == "-1") {
+		hopKind = HOP_UNMAPPED;
+	} else if (IP == "xxx.xxx.xxx.xxx") {
+		hopKind = HOP_ANY;
+	} else if (!parseIPv4(IP, nextHopIP) || nextHopIP == 0) {
+		nextHopIP = 0;
+		if (!IP.empty()) {
+			loggyErr("[CCPDN-ERROR]: Flow next hop " + IP + " is not an IPv4 address, flow has no next hop\n");
+		}
+	}
+}
+
+void Flow::setRulePrefix(const std::string& prefix)
+{
+	rulePrefix = 0;
+	prefixLength = NO_PREFIX;
+	prefixBare = false;
+
+	// "address/length", or a bare address (kept bare so it prints back the same)
+	size_t slash = prefix.find('/');
+	uint32_t address;
+	if (!parseIPv4(prefix.substr(0, slash), address)) {
+		return;
+	}
+
+	int length = 32;
+	if (slash == std::string::npos) {
+		prefixBare = true;
+	} else {
+		std::string lengthStr = prefix.substr(slash + 1);
+		if (lengthStr.empty() || lengthStr.size() > 2 || lengthStr.find_first_not_of("0123456789") != std::string::npos) {
+			return;
+		}
+		length = std::stoi(lengthStr);
+		if (length > 32) {
+			return;
+		}
+	}
+
+	rulePrefix = address;
+	prefixLength = (uint8_t)length;
 }
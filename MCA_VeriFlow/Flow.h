@@ -5,57 +5,121 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
 #include "Log.h"
 
+/// A single flow rule: packed into 24 trivially copyable bytes.
+///
+/// Addresses are held as host-order uint32s and the prefix as address + length, so comparing, hashing
+/// and copying flows never touches a string. The string getters/constructor are the edges -- they
+/// format and parse on the way in and out. Address 0 stands for "no address" (formats as "").
+
 class Flow {
 	public:
 		// Constructors & destructors
 		Flow(std::string SwitchIP, std::string RulePrefix, std::string NextHopIP, bool Action);
 		Flow();
-		~Flow();
 
-		// Equality operator (for finding dupes)
+		// Equality operator (for finding dupes) -- action and modification flags aren't part of identity
 		bool operator==(const Flow& other) const {
-			return (switchIP == other.switchIP && rulePrefix == other.rulePrefix && nextHopIP == other.nextHopIP);
+			return (switchIP == other.switchIP && rulePrefix == other.rulePrefix && prefixLength == other.prefixLength
+				&& prefixBare == other.prefixBare && nextHopIP == other.nextHopIP && hopKind == other.hopKind);
 		}
 
 		// Marshalling methods
-		std::string flowToStr(bool printDPID);
+		std::string flowToStr(bool printDPID) const;
 		static Flow strToFlow(std::string payload);
 		static std::vector<std::string> splitFlowString(std::string flow);
 
+		// Fixed-width wire form for binary digests -- same fields as flowToStr(false), addresses big-endian
+		static constexpr size_t PACKED_SIZE = 14;
+		void pack(uint8_t* out) const;
+		static Flow unpack(const uint8_t* in);
+
+		// IPv4 helpers -- dotted quad <-> host-order integer
+		static bool parseIPv4(const std::string& IP, uint32_t& address);
+		static std::string formatIPv4(uint32_t address);
+
 		// Helper methods
-		bool isEmptyFlow() { return (switchIP.empty() && rulePrefix.empty() && nextHopIP.empty()); }
+		bool isEmptyFlow() const { return (switchIP == 0 && prefixLength == NO_PREFIX && nextHopIP == 0 && hopKind == HOP_ADDRESS); }
+		bool hasSwitch() const { return switchIP != 0; }
+		bool hasNextHop() const { return (hopKind != HOP_ADDRESS || nextHopIP != 0); }
+		bool isSelfLoop() const { return (hopKind == HOP_ADDRESS && switchIP == nextHopIP); }
 
 		// Misc methods
 		void print();
 
-		// Getters
-		std::string getSwitchIP();
-		std::string getRulePrefix();
-		std::string getNextHopIP();
-		bool actionType();
-		Flow inverseFlow();
+		// Getters (formatted)
+		std::string getSwitchIP() const;
+		std::string getRulePrefix() const;
+		std::string getNextHopIP() const;
+		bool actionType() const { return action; }
+		Flow inverseFlow() const;
 		void setAction(bool action) { this->action = action; }
 
-		bool isMod();
-		void setMod(bool mod);
+		// Getters (packed)
+		uint32_t getSwitchAddress() const { return switchIP; }
+		uint32_t getNextHopAddress() const { return (hopKind == HOP_ADDRESS) ? nextHopIP : 0; }
+		uint32_t getPrefixAddress() const { return rulePrefix; }
+		int getPrefixLength() const { return (prefixLength == NO_PREFIX) ? -1 : prefixLength; }
 
-		bool isFlowModify() { return Modification; }
+		// Setters (parse their argument)
+		void setSwitchIP(const std::string& IP);
+		void setNextHopIP(const std::string& IP);
+		void setRulePrefix(const std::string& prefix);
+
+		bool isMod() const { return isFlowMod; }
+		void setMod(bool mod) { isFlowMod = mod; }
+
+		bool isFlowModify() const { return Modification; }
 		void setFlowModify(bool mod) { Modification = mod; }
 
-		void setDPID(std::string switchDP, std::string hopDP) { switchDPID = switchDP; outPort = hopDP; }
+		void setDPID(uint64_t switchDP, uint16_t hopDP) { switchDPID = switchDP; outPort = hopDP; }
+		uint64_t getSwitchDPID() const { return switchDPID; }
+		uint16_t getOutPort() const { return outPort; }
+
+		// Hash over the same fields as operator==
+		size_t hash() const {
+			uint64_t high = (uint64_t(switchIP) << 32) | nextHopIP;
+			uint64_t low = (uint64_t(rulePrefix) << 32) | (uint64_t(prefixLength) << 8) | (uint64_t(prefixBare) << 2) | hopKind;
+			return std::hash<uint64_t>()(high * 0x9E3779B97F4A7C15ULL ^ low);
+		}
 
 	private:
-		std::string switchDPID;
-		std::string outPort;
-
-		std::string switchIP;
-		std::string rulePrefix;
-		std::string nextHopIP;
-		bool action;
-		bool isFlowMod;
-		bool Modification;
+		// prefixLength when the flow has no rule prefix
+		static constexpr uint8_t NO_PREFIX = 0xFF;
+
+		// What the next hop holds besides a plain address
+		enum HopKind : uint8_t {
+			HOP_ADDRESS = 0,	// nextHopIP (0 formats as "")
+			HOP_UNMAPPED = 1,	// "-1", output port couldn't be mapped to a neighbour
+			HOP_ANY = 2			// "xxx.xxx.xxx.xxx", domain node hop into another topology
+		};
+
+		uint64_t switchDPID;
+		uint32_t switchIP;
+		uint32_t rulePrefix;
+		uint32_t nextHopIP;
+		uint16_t outPort;
+		uint8_t prefixLength;
+		uint8_t action : 1;
+		uint8_t isFlowMod : 1;
+		uint8_t Modification : 1;
+		uint8_t prefixBare : 1;		// Prefix was written without a "/length"
+		uint8_t hopKind : 2;
 };
 
-#endif
\ No newline at end of file
+static_assert(std::is_trivially_copyable<Flow>::value, "Flow must stay trivially copyable");
+static_assert(sizeof(Flow) == 24, "Flow must stay packed into 24 bytes");
+
+namespace std {
+	template <>
+	struct hash<Flow> {
+		size_t operator()(const Flow& f) const { return f.hash(); }
+	};
+}
+
+#endif
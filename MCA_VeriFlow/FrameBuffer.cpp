@@ -0,0 +1,107 @@
+#include "FrameBuffer.h"
+
+FrameBuffer::FrameBuffer()
+{
+	readOffset = 0;
+	scanned = 0;
+	lengthPrefixed = false;
+	corrupt = false;
+}
+
+std::vector<uint8_t> FrameBuffer::encode(const std::string& payload)
+{
+	uint32_t length = static_cast<uint32_t>(payload.size());
+
+	std::vector<uint8_t> frame;
+	frame.reserve(FRAME_HEADER_SIZE + payload.size());
+	frame.push_back(static_cast<uint8_t>(length >> 24));
+	frame.push_back(static_cast<uint8_t>(length >> 16));
+	frame.push_back(static_cast<uint8_t>(length >> 8));
+	frame.push_back(static_cast<uint8_t>(length));
+	frame.insert(frame.end(), payload.begin(), payload.end());
+	return frame;
+}
+
+std::vector<uint8_t> FrameBuffer::encodeDelimited(const std::string& payload)
+{
+	std::vector<uint8_t> frame(payload.begin(), payload.end());
+	frame.push_back('\0');
+	return frame;
+}
+
+void FrameBuffer::append(const uint8_t* data, size_t length)
+{
+	// Everything before readOffset has been handed out -- drop it before growing
+	if (readOffset > 0 && readOffset == buffer.size()) {
+		buffer.clear();
+		readOffset = 0;
+	} else if (readOffset > buffer.size() / 2) {
+		buffer.erase(buffer.begin(), buffer.begin() + readOffset);
+		readOffset = 0;
+	}
+
+	buffer.insert(buffer.end(), data, data + length);
+}
+
+bool FrameBuffer::next(std::string& payload)
+{
+	if (!lengthPrefixed) {
+		return nextDelimited(payload);
+	}
+
+	if (corrupt || buffer.size() - readOffset < FRAME_HEADER_SIZE) {
+		return false;
+	}
+
+	const uint8_t* header = buffer.data() + readOffset;
+	uint32_t length = (static_cast<uint32_t>(header[0]) << 24) | (static_cast<uint32_t>(header[1]) << 16)
+		| (static_cast<uint32_t>(header[2]) << 8) | header[3];
+	if (length > MAX_FRAME_SIZE) {
+		corrupt = true;
+		return false;
+	}
+
+	// Wait for the rest of the payload
+	if (buffer.size() - readOffset - FRAME_HEADER_SIZE < length) {
+		return false;
+	}
+
+	const char* start = reinterpret_cast<const char*>(header + FRAME_HEADER_SIZE);
+	payload.assign(start, length);
+	readOffset += FRAME_HEADER_SIZE + length;
+	return true;
+}
+
+bool FrameBuffer::nextDelimited(std::string& payload)
+{
+	while (!corrupt) {
+		// Only search what hasn't been searched yet
+		const uint8_t* start = buffer.data() + readOffset;
+		size_t available = buffer.size() - readOffset;
+		const void* end = (scanned < available) ? std::memchr(start + scanned, '\0', available - scanned) : nullptr;
+		if (end == nullptr) {
+			scanned = available;
+			corrupt = (available > MAX_FRAME_SIZE);
+			return false;
+		}
+
+		size_t length = static_cast<const uint8_t*>(end) - start;
+		readOffset += length + 1;
+		scanned = 0;
+
+		// Empty messages were always skipped
+		if (length > 0) {
+			payload.assign(reinterpret_cast<const char*>(start), length);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameBuffer::clear()
+{
+	buffer.clear();
+	readOffset = 0;
+	scanned = 0;
+	corrupt = false;
+}
@@ -0,0 +1,61 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Bytes in a frame header (big-endian payload length)
+#define FRAME_HEADER_SIZE 4
+// Largest payload accepted from a peer -- anything bigger means the stream is out of sync
+#define MAX_FRAME_SIZE (64 * 1024 * 1024)
+
+/// Length-prefixed framing for CCPDN digests.
+///
+/// Every message goes out as a 4-byte big-endian payload length followed by the payload. The receiving
+/// side keeps one FrameBuffer per socket: received bytes are appended as they arrive and whole frames
+/// are taken off the front, so a message can be any size and may be split across (or share) recv() calls.
+///
+/// Older CCPDN instances end each message with a NUL instead, so every connection starts out NUL-delimited
+/// and each direction switches to length prefixes in-band once both sides agreed to it (see the Controller's
+/// greeting). setLengthPrefixed() is called right after the last delimited frame is taken off, bytes
+/// already buffered behind it are then read as length-prefixed frames.
+
+class FrameBuffer {
+	public:
+		FrameBuffer();
+
+		// Build the wire form of a single message
+		static std::vector<uint8_t> encode(const std::string& payload);
+		static std::vector<uint8_t> encodeDelimited(const std::string& payload);
+
+		// Add bytes received from the socket
+		void append(const uint8_t* data, size_t length);
+
+		// Take the next complete frame's payload, returns false if no whole frame is buffered yet
+		bool next(std::string& payload);
+
+		// True once a header announced a frame over MAX_FRAME_SIZE (or a delimited one grew past it) -- the connection should be dropped
+		bool isCorrupt() const { return corrupt; }
+
+		// Frames are NUL-delimited until this is called, length-prefixed from then on
+		void setLengthPrefixed() { lengthPrefixed = true; }
+		bool isLengthPrefixed() const { return lengthPrefixed; }
+
+		void clear();
+
+	private:
+		std::vector<uint8_t> buffer;
+		// Start of the first unconsumed byte -- consumed bytes are compacted away lazily
+		size_t readOffset;
+		// Delimited mode: bytes past readOffset already searched for a NUL, so a long message isn't rescanned on every append
+		size_t scanned;
+		bool lengthPrefixed;
+		bool corrupt;
+
+		bool nextDelimited(std::string& payload);
+};
+
+#endif
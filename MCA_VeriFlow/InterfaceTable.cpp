@@ -0,0 +1,252 @@
+#include "InterfaceTable.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+// Netlink receive buffer -- large enough for a full dump chunk
+#define NETLINK_BUFFER_SIZE 16384
+
+InterfaceTable::InterfaceTable()
+{
+	sockNotify = -1;
+	ready = false;
+	running = false;
+
+#ifdef __linux__
+	// Subscribe before dumping so no change can slip in between -- replayed notifications are idempotent
+	sockNotify = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (sockNotify < 0) {
+		loggyErr("[CCPDN-ERROR]: Could not open rtnetlink socket, interface table disabled\n");
+		return;
+	}
+
+	sockaddr_nl local;
+	std::memset(&local, 0, sizeof(local));
+	local.nl_family = AF_NETLINK;
+	local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR;
+	if (bind(sockNotify, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+		loggyErr("[CCPDN-ERROR]: Could not bind rtnetlink socket, interface table disabled\n");
+		close(sockNotify);
+		sockNotify = -1;
+		return;
+	}
+
+	// Load links first so addresses can be named as soon as they arrive
+	if (!dump(RTM_GETLINK) || !dump(RTM_GETADDR)) {
+		loggyErr("[CCPDN-ERROR]: rtnetlink dump failed, interface table disabled\n");
+		close(sockNotify);
+		sockNotify = -1;
+		return;
+	}
+
+	ready = true;
+	running = true;
+	listener = std::thread(&InterfaceTable::listen, this);
+#endif
+}
+
+InterfaceTable::~InterfaceTable()
+{
+	running = false;
+	if (listener.joinable()) {
+		listener.join();
+	}
+
+#ifdef __linux__
+	if (sockNotify != -1) {
+		close(sockNotify);
+		sockNotify = -1;
+	}
+#endif
+}
+
+std::string InterfaceTable::getInterfaceByIP(const std::string& IP)
+{
+#ifdef __linux__
+	in_addr address;
+	if (inet_pton(AF_INET, IP.c_str(), &address) != 1) {
+		return "";
+	}
+
+	std::lock_guard<std::mutex> lock(tableMutex);
+	auto addressIt = addressIndex.find(address.s_addr);
+	if (addressIt == addressIndex.end()) {
+		return "";
+	}
+
+	auto nameIt = indexName.find(addressIt->second);
+	if (nameIt != indexName.end()) {
+		return nameIt->second;
+	}
+
+	// Address arrived before its link -- ask the kernel directly
+	char name[IF_NAMESIZE];
+	if (if_indextoname(addressIt->second, name) != nullptr) {
+		return std::string(name);
+	}
+#endif
+
+	return "";
+}
+
+#ifdef __linux__
+bool InterfaceTable::dump(int type)
+{
+	// Dumps use their own socket so their replies don't interleave with notifications
+	int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (sock < 0) {
+		return false;
+	}
+
+	// Request header followed by an rtgenmsg selecting the family
+	struct {
+		nlmsghdr header;
+		rtgenmsg body;
+	} request;
+	std::memset(&request, 0, sizeof(request));
+	request.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtgenmsg));
+	request.header.nlmsg_type = type;
+	request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	request.header.nlmsg_seq = 1;
+	request.body.rtgen_family = (type == RTM_GETADDR) ? AF_INET : AF_UNSPEC;
+
+	if (send(sock, &request, request.header.nlmsg_len, 0) < 0) {
+		close(sock);
+		return false;
+	}
+
+	// Read until the kernel marks the dump as done
+	alignas(nlmsghdr) char buffer[NETLINK_BUFFER_SIZE];
+	bool done = false;
+	bool success = true;
+	while (!done) {
+		ssize_t length = recv(sock, buffer, sizeof(buffer), 0);
+		if (length <= 0) {
+			success = false;
+			break;
+		}
+
+		for (nlmsghdr* message = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(message, length); message = NLMSG_NEXT(message, length)) {
+			if (message->nlmsg_type == NLMSG_DONE) {
+				done = true;
+				break;
+			}
+			if (message->nlmsg_type == NLMSG_ERROR) {
+				done = true;
+				success = false;
+				break;
+			}
+			handleMessage(message);
+		}
+	}
+
+	close(sock);
+	return success;
+}
+
+void InterfaceTable::listen()
+{
+	alignas(nlmsghdr) char buffer[NETLINK_BUFFER_SIZE];
+
+	while (running) {
+		// Wake up once a second to notice shutdown
+		pollfd descriptor;
+		descriptor.fd = sockNotify;
+		descriptor.events = POLLIN;
+		descriptor.revents = 0;
+		if (poll(&descriptor, 1, 1000) <= 0) {
+			continue;
+		}
+
+		ssize_t length = recv(sockNotify, buffer, sizeof(buffer), 0);
+		if (length < 0) {
+			// Kernel dropped notifications (ENOBUFS) -- rebuild the table from scratch
+			if (errno == ENOBUFS) {
+				loggy << "[CCPDN]: Interface notifications overflowed, reloading interface table" << std::endl;
+				{
+					std::lock_guard<std::mutex> lock(tableMutex);
+					addressIndex.clear();
+					indexName.clear();
+				}
+				dump(RTM_GETLINK);
+				dump(RTM_GETADDR);
+			}
+			continue;
+		}
+
+		for (nlmsghdr* message = reinterpret_cast<nlmsghdr*>(buffer); NLMSG_OK(message, length); message = NLMSG_NEXT(message, length)) {
+			handleMessage(message);
+		}
+	}
+}
+
+void InterfaceTable::handleMessage(const void* data)
+{
+	const nlmsghdr* message = static_cast<const nlmsghdr*>(data);
+
+	switch (message->nlmsg_type) {
+		case RTM_NEWLINK:
+		case RTM_DELLINK: {
+			const ifinfomsg* info = static_cast<const ifinfomsg*>(NLMSG_DATA(message));
+			int attributeLength = IFLA_PAYLOAD(message);
+
+			std::lock_guard<std::mutex> lock(tableMutex);
+			if (message->nlmsg_type == RTM_DELLINK) {
+				// Interface is gone -- so are its addresses
+				indexName.erase(info->ifi_index);
+				for (auto it = addressIndex.begin(); it != addressIndex.end();) {
+					it = (it->second == info->ifi_index) ? addressIndex.erase(it) : std::next(it);
+				}
+				break;
+			}
+
+			for (const rtattr* attribute = IFLA_RTA(info); RTA_OK(attribute, attributeLength); attribute = RTA_NEXT(attribute, attributeLength)) {
+				if (attribute->rta_type == IFLA_IFNAME) {
+					indexName[info->ifi_index] = static_cast<const char*>(RTA_DATA(attribute));
+				}
+			}
+			break;
+		}
+		case RTM_NEWADDR:
+		case RTM_DELADDR: {
+			const ifaddrmsg* info = static_cast<const ifaddrmsg*>(NLMSG_DATA(message));
+			if (info->ifa_family != AF_INET) {
+				break;
+			}
+			int attributeLength = IFA_PAYLOAD(message);
+
+			// IFA_LOCAL is the interface's own address (IFA_ADDRESS is the peer on point-to-point links)
+			uint32_t address = 0;
+			bool found = false;
+			for (const rtattr* attribute = IFA_RTA(info); RTA_OK(attribute, attributeLength); attribute = RTA_NEXT(attribute, attributeLength)) {
+				if (attribute->rta_type == IFA_LOCAL || (attribute->rta_type == IFA_ADDRESS && !found)) {
+					std::memcpy(&address, RTA_DATA(attribute), sizeof(address));
+					found = true;
+				}
+			}
+			if (!found) {
+				break;
+			}
+
+			std::lock_guard<std::mutex> lock(tableMutex);
+			if (message->nlmsg_type == RTM_NEWADDR) {
+				addressIndex[address] = static_cast<int>(info->ifa_index);
+			} else {
+				addressIndex.erase(address);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+#endif
@@ -0,0 +1,57 @@
+#ifndef INTERFACETABLE_H
+#define INTERFACETABLE_H
+
+#include <string>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include "Log.h"
+
+/// In-process map of local IPv4 addresses to the interface that owns them.
+///
+/// Built from an rtnetlink dump of every link and address, then kept current by a listener thread
+/// subscribed to link/address change notifications -- so lookups never fork a shell. On platforms
+/// without rtnetlink the table stays empty and callers fall back to their old discovery path.
+
+class InterfaceTable {
+	public:
+		// Singleton instance -- started on first use
+		static InterfaceTable& getInstance() {
+			static InterfaceTable instance;
+			return instance;
+		}
+
+		// Name of the interface holding IP (dotted quad), or "" if no local interface has it
+		std::string getInterfaceByIP(const std::string& IP);
+
+		// True once the initial dump has been loaded
+		bool isReady() const { return ready.load(); }
+
+	private:
+		InterfaceTable();
+		~InterfaceTable();
+
+		// Disable copy and assignment
+		InterfaceTable(const InterfaceTable&) = delete;
+		InterfaceTable& operator=(const InterfaceTable&) = delete;
+
+#ifdef __linux__
+		bool dump(int type);
+		void listen();
+		void handleMessage(const void* message);
+#endif
+
+		// Address (network order) -> interface index, interface index -> name
+		std::unordered_map<uint32_t, int> addressIndex;
+		std::unordered_map<int, std::string> indexName;
+		std::mutex tableMutex;
+
+		int sockNotify;
+		std::atomic<bool> ready;
+		std::atomic<bool> running;
+		std::thread listener;
+};
+
+#endif
@@ -61,7 +61,7 @@ MCA_VeriFlow::MCA_VeriFlow()
 {
     Topology t;
     topology = t;
-    controller = Controller(&topology);
+    controller.setTopology(&topology);
     controller_running = false;
     controller_linked = false;
     topology_initialized = false;
@@ -87,16 +87,17 @@ void MCA_VeriFlow::run()
     // Create CCPDN server, bind to the correct port and listen for connections
     int portCC = controller.basePort + topology.hostIndex;
     
-    // Start CCPDN server connection handler thread (for accepting new connections)
+    // Start CCPDN server thread (accepts new connections and receives digests from all of them)
     std::thread ccpdnServerThread(&Controller::CCPDNServerThread, &controller, portCC, &runService);
     ccpdnServerThread.detach();
 
-    // Start CCPDN message receiver thread (for digests)
-    std::thread ccpdnMessageThread(&Controller::CCPDNThread, &controller, &runService);
-    ccpdnMessageThread.detach();
+    // Start the peer manager (connects to the other CCPDN instances as they come up, and reconnects lost ones)
+    std::thread ccpdnPeerThread(&Controller::CCPDNPeerThread, &controller, &runService);
+    ccpdnPeerThread.detach();
 
-    // Don't initiate CCPDN connections until the operator is ready
-    // controller.initCCPDN();
+    // Start the request worker (answers verification and flow list requests from other instances off the reactor)
+    std::thread ccpdnRequestThread(&Controller::CCPDNRequestThread, &controller, &runService);
+    ccpdnRequestThread.detach();
 
     // Start TCPDump thread to listen for controller messages
     TCPAnalyzer tcp;
@@ -104,7 +105,7 @@ void MCA_VeriFlow::run()
     tcpDumpThread.detach();
 
     loggy << "[CCPDN]: CCPDN Service started" << std::endl;
-    loggy << "Please use 'retry-ccpdn' once all other CCPDN instances are started" << std::endl;
+    loggy << "Other CCPDN instances are connected automatically, 'retry-ccpdn' skips the reconnect wait" << std::endl;
     loggy << "Use 'status' to check the status of all expected connections" << std::endl;
 }
 
@@ -218,54 +219,19 @@ bool MCA_VeriFlow::createDomainNodes()
     /// Use loop to shift scope to only two topologies at a time
     for (int i = 0; i < expectedDomainNodes; i++) {
 
-        std::vector<Node> topology1 = topology.getTopology(i);
-        std::vector<Node> topology2 = topology.getTopology(i + 1);
         std::vector<Node> candidate_domain_nodes;
 
-        /// Filter nodelist to only nodes that have links and are switches
-        for (int j = 0; j < topology1.size(); j++) {
-            if (topology1.at(j).getLinks().size() > 0 && topology1.at(j).isSwitch()) {
-                candidate_domain_nodes.push_back(topology1.at(j));
-            }
-        }
-
-        for (int j = 0; j < topology2.size(); j++) {
-            if (topology2.at(j).getLinks().size() > 0 && topology2.at(j).isSwitch()) {
-                candidate_domain_nodes.push_back(topology2.at(j));
-            }
-        }
-
-        /// Filter nodelist so it only contains inter-topology links
-        std::vector<int> mark_for_removal;
-        for (Node n : candidate_domain_nodes) {
-            for (std::string link : n.getLinks()) {
-                // Check if the current node is linked to any node in the other topology based on IP
-                bool found = false;
-                Node m = topology.getNodeByIP(link);
-                if (!n.isMatchingDomain(m) && !m.isEmptyNode()) {
-					found = true;
-                    break;
-				}
-                
-                if (!found) {
-                    // Get index of current node n
-                    for (int k = 0; k < candidate_domain_nodes.size(); k++) {
-                        if (candidate_domain_nodes.at(k) == n) {
-							mark_for_removal.push_back(k);
-							break;
-						}
-					}
-                    break;
+        /// Filter nodelist to only switches that have links, and whose (first) link is inter-topology
+        for (int t = i; t <= i + 1; t++) {
+            std::span<const Node> nodes = topology.viewTopology(t);
+            for (int j = 0; j < nodes.size(); j++) {
+                std::span<const Topology::Link> links = topology.getAdjacency(t, j);
+                if (nodes[j].isSwitch() && !links.empty() && links.front().interDomain) {
+                    candidate_domain_nodes.push_back(nodes[j]);
                 }
             }
         }
 
-        // Commit the removal of non-candidates
-        std::sort(mark_for_removal.rbegin(), mark_for_removal.rend());
-        for (int j = 0; j < mark_for_removal.size(); j++) {
-            candidate_domain_nodes.erase(candidate_domain_nodes.begin() + mark_for_removal.at(j));
-		}
-
         // There are no domain node candidates if the list is empty now
         if (candidate_domain_nodes.size() == 0) {
             std::cerr << "Could not find domain node candidates between topology " << i << " and topology " << i + 1 << std::endl;
@@ -335,8 +301,13 @@ Topology MCA_VeriFlow::partitionTopology()
             for (std::string link : currLinks) {
 				Node m = t.getNodeByIP(link);
                 if (!n->isMatchingDomain(m) && !m.isEmptyNode() && (!m.isDomainNode() && !n->isDomainNode())) {
-                    // If the node is not a domain node, remove the link
-					n->removeLink(link);
+                    // If the node is not a domain node, remove the link (through the topology so its link graph follows)
+					Topology::Delta removal;
+					removal.op = Topology::Delta::LINK_REMOVE;
+					removal.isSwitch = n->isSwitch();
+					removal.IP = n->getIP();
+					removal.links.push_back(link);
+					t.applyDelta(n->getTopologyID(), removal);
                 }
             }
         }
@@ -440,7 +411,7 @@ void MCA_VeriFlow::printStatus()
 
     loggy << "CCPDN Connections:" << std::endl;
     for (int i = 0; i < topology.getTopologyCount(); i++) {
-        bool isInstanceConnected = (controller.socketTopologyMap.find(i) != controller.socketTopologyMap.end());
+        bool isInstanceConnected = (controller.isPeerConnected(i));
         if (i != topology.hostIndex) {
             loggy << " - Topology " << i << ": [CONNECTION-" << (isInstanceConnected ? "ACTIVE]" : "INACTIVE]") << std::endl;
         } else {
@@ -579,9 +550,7 @@ int main() {
     while (true) {
 
         // If link_controller is sending packets/receiving packets, wait for that to finish
-        while (Controller::pauseOutput) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
+        Controller::pauseOutput.waitFor(false);
 
         std::string input;
         loggy << std::endl;
@@ -635,6 +604,8 @@ int main() {
                 "   Link this app to the flow handler, allowing for dynamic flow access (default port = 6655).\n" << std::endl <<
                 " * reset-fh" << std::endl <<
                 "   Free the flowhandler connection from this app.\n" << std::endl <<
+                " - direct-install [on/off]:" << std::endl <<
+                "   Encode flow mods in the CCPDN and have the flow handler forward them to switches as-is (default = off).\n" << std::endl <<
                 " - list-flows [switch-ip-address]:" << std::endl <<
                 "   List all the flows associated with a switch based on its IP.\n" << std::endl <<
                 " - add-flow [switch-ip-address] [rule-prefix] [next-hop-ip-address]" << std::endl <<
@@ -652,6 +623,16 @@ int main() {
             mca_veriflow->printStatus();
         }
 
+        // direct-install command
+        else if (args.at(0) == "direct-install") {
+            if (args.size() < 2 || (args.at(1) != "on" && args.at(1) != "off")) {
+                loggy << "Not enough arguments. Usage: direct-install [on/off]" << std::endl;
+                continue;
+            }
+            mca_veriflow->controller.directFlowInstall = (args.at(1) == "on");
+            loggy << "Direct flow install " << (mca_veriflow->controller.directFlowInstall ? "enabled." : "disabled.") << std::endl;
+        }
+
         // link-flowhandler command
         else if (args.at(0) == "link-flowhandler") {
             if (args.size() < 3) {
@@ -7,6 +7,7 @@
 #include <string>
 #include <chrono>
 #include <thread>
+#include <atomic>
 #include <numeric>
 #include <cstring>
 #include <algorithm>
@@ -42,10 +43,11 @@ class MCA_VeriFlow {
 
 		Topology topology;
 		Controller controller;
-		bool controller_running;
-		bool runService;
+		// Loop guards for the service threads, read by them while the CLI writes them
+		std::atomic<bool> controller_running;
+		std::atomic<bool> runService;
 		bool controller_linked;
-		bool flowhandler_linked;
+		std::atomic<bool> flowhandler_linked;
 		bool topology_initialized;
 
 		bool runningTCPTest;
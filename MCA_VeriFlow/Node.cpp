@@ -51,6 +51,14 @@ bool Node::removeLink(std::string IP) {
 	return false;
 }
 
+bool Node::addLink(std::string IP) {
+	if (isLinkedTo(IP)) {
+		return false;
+	}
+	linkList.push_back(IP);
+	return true;
+}
+
 void Node::setDomainNode(bool DomainNode, std::string topologies) {
 	/// This method is very messy and terrible. But it works.
 
@@ -99,22 +107,22 @@ void Node::setDomainNode(bool DomainNode, std::string topologies) {
 	}
 }
 
-bool Node::isSwitch() {
+bool Node::isSwitch() const {
 	return switchNode;
 }
 
-bool Node::isDomainNode() {
+bool Node::isDomainNode() const {
 	return domainNode;
 }
 
-bool Node::isEmptyNode() {
+bool Node::isEmptyNode() const {
 	if (IP == "-1" || topologyIndex == -1) {
 		return true;
 	}
 	return false;
 }
 
-bool Node::isMatchingDomain(Node n)
+bool Node::isMatchingDomain(const Node& n) const
 {
 	if (n.getTopologyID() == topologyIndex) {
 		return true;
@@ -122,7 +130,7 @@ bool Node::isMatchingDomain(Node n)
 	return false;
 }
 
-int Node::getTopologyID()
+int Node::getTopologyID() const
 {
 	return topologyIndex;
 }
@@ -137,7 +145,7 @@ void Node::setControllerAdjacency(bool value)
 	controllerAdjacency = value;
 }
 
-std::string Node::getIP()
+const std::string& Node::getIP() const
 {
 	return IP;
 }
@@ -160,7 +168,7 @@ std::string Node::print()
 	return isSwitch + IP + "\n" + links + domainNodeString;
 }
 
-bool Node::connectsToTopology(int topologyIndex) {
+bool Node::connectsToTopology(int topologyIndex) const {
     if (!domainNode || linkingTopologies == "null") {
         return false;
     }
@@ -184,7 +192,7 @@ bool Node::connectsToTopology(int topologyIndex) {
     return false;
 }
 
-bool Node::isLinkedTo(std::string IP)
+bool Node::isLinkedTo(const std::string& IP) const
 {
 	bool success = false;
 	for (int i = 0; i < linkList.size(); i++) {
@@ -197,7 +205,7 @@ bool Node::isLinkedTo(std::string IP)
     return success;
 }
 
-std::vector<std::string> Node::getLinks()
+const std::vector<std::string>& Node::getLinks() const
 {
 	return linkList;
 }
@@ -20,28 +20,29 @@ class Node {
 		}
 
 		void setDomainNode(bool domainNode, std::string topologies);
-		bool isSwitch();
-		bool isDomainNode();
-		bool isMatchingDomain(Node node);
-		bool isEmptyNode();
+		bool isSwitch() const;
+		bool isDomainNode() const;
+		bool isMatchingDomain(const Node& node) const;
+		bool isEmptyNode() const;
 		bool removeLink(std::string IP);
+		bool addLink(std::string IP);
 		bool hasAdjacentController();
 		void setControllerAdjacency(bool value);
 		void setPingResult(bool value);
-		bool connectsToTopology(int topologyIndex);
-		bool isLinkedTo(std::string IP);
+		bool connectsToTopology(int topologyIndex) const;
+		bool isLinkedTo(const std::string& IP) const;
 		void clearLinks() { linkList.clear(); }
 
-		int getTopologyID();
+		int getTopologyID() const;
 		bool getPingResult();
-		std::string getIP();
-		std::vector<std::string> getLinks();
+		const std::string& getIP() const;
+		const std::vector<std::string>& getLinks() const;
 
 		std::string print();
 		std::string filePrint();
 
 		void setTopologyID(int id) { topologyIndex = id; }
-		std::string getConnectingTopologies() { return linkingTopologies; }
+		const std::string& getConnectingTopologies() const { return linkingTopologies; }
 
 	private:
 		int							topologyIndex;	// Which topology this node belongs to
@@ -10,8 +10,89 @@
 #define htonll(x) (((uint64_t)htonl((uint32_t)((x << 32) >> 32))) << 32) | htonl(((uint32_t)(x >> 32)))
 #endif
 
-std::vector<unsigned char> OpenFlowMessage::createHello(uint32_t XID)
+OpenFlowView::OpenFlowView(std::span<const uint8_t> data)
+{
+	isValid = false;
+	message = data.first(0);
+
+	// Need a full header before we can trust the length field
+	if (data.size() < sizeof(ofp_header)) {
+		return;
+	}
+
+	uint16_t declaredLength = (static_cast<uint16_t>(data[2]) << 8) | data[3];
+	if (declaredLength < sizeof(ofp_header) || declaredLength > data.size()) {
+		return;
+	}
+
+	message = data.first(declaredLength);
+	isValid = true;
+}
+
+uint8_t OpenFlowView::version() const
+{
+	return isValid ? message[0] : 0;
+}
+
+uint8_t OpenFlowView::type() const
+{
+	return isValid ? message[1] : 0xFF;
+}
+
+uint16_t OpenFlowView::length() const
+{
+	return isValid ? static_cast<uint16_t>(message.size()) : 0;
+}
+
+uint32_t OpenFlowView::xid() const
+{
+	if (!isValid) {
+		return 0;
+	}
+	return (static_cast<uint32_t>(message[4]) << 24) | (static_cast<uint32_t>(message[5]) << 16)
+		| (static_cast<uint32_t>(message[6]) << 8) | static_cast<uint32_t>(message[7]);
+}
+
+std::span<const uint8_t> OpenFlowView::body(size_t fixedSize) const
+{
+	if (!isValid || fixedSize > message.size()) {
+		return message.first(0);
+	}
+	return message.subspan(fixedSize);
+}
+
+const ofp_header* OpenFlowView::header() const
+{
+	return isValid ? reinterpret_cast<const ofp_header*>(message.data()) : nullptr;
+}
+
+const ofp_flow_mod* OpenFlowView::flowMod() const
+{
+	return as<ofp_flow_mod>(OFPT_FLOW_MOD);
+}
+
+const ofp_flow_removed* OpenFlowView::flowRemoved() const
+{
+	return as<ofp_flow_removed>(OFPT_FLOW_REMOVED);
+}
+
+const ofp_stats_request* OpenFlowView::statsRequest() const
 {
+	return as<ofp_stats_request>(OFPT_STATS_REQUEST);
+}
+
+const ofp_stats_reply* OpenFlowView::statsReply() const
+{
+	return as<ofp_stats_reply>(OFPT_STATS_REPLY);
+}
+
+size_t OpenFlowMessage::encodeHello(std::span<unsigned char> out, uint32_t XID)
+{
+	// Ensure the caller's buffer can hold the message
+	if (out.size() < sizeof(ofp_header)) {
+		return 0;
+	}
+
 	// Initialize header struct
 	ofp_header header;
 	std::memset(&header, 0, sizeof(header));
@@ -23,17 +104,21 @@ std::vector<unsigned char> OpenFlowMessage::createHello(uint32_t XID)
 	header.length = htons(sizeof(ofp_header));
 	header.xid = htonl(XID);
 #endif
-	
-    // Create an unsigned char (blessed casting type) vector to store our struct
-	std::vector<unsigned char> buffer(sizeof(ofp_header));
+
 	// Store the first 8 bytes (ofp_header struct, byte 1-8)
-	std::memcpy(buffer.data(), &header, sizeof(ofp_header));
+	std::memcpy(out.data(), &header, sizeof(ofp_header));
 
-	return buffer;
+	return sizeof(ofp_header);
 }
 
-std::vector<unsigned char> OpenFlowMessage::createFlowRequest()
+size_t OpenFlowMessage::encodeFlowRequest(std::span<unsigned char> out, uint32_t XID)
 {
+	// Ensure the caller's buffer can hold the message
+	const size_t length = sizeof(ofp_stats_request) + sizeof(ofp_flow_stats_request);
+	if (out.size() < length) {
+		return 0;
+	}
+
 	// Construct our ofp_stats_request struct, and initialize it
 	ofp_stats_request request;
 	std::memset(&request, 0, sizeof(ofp_stats_request));
@@ -46,8 +131,8 @@ std::vector<unsigned char> OpenFlowMessage::createFlowRequest()
 	// Populate ofp_stats_request struct fields
 	request.header.version = OFP_10;
 	request.header.type = OFPT_STATS_REQUEST;
-	request.header.length = htons(sizeof(ofp_stats_request) + sizeof(ofp_flow_stats_request));
-	request.header.xid = htonl(100 + (std::rand() % 4095 - 99)); // XID is not used in hello message
+	request.header.length = htons(length);
+	request.header.xid = htonl(XID);
 	request.type = htons(OFPST_FLOW);
 	request.flags = htons(0); // No flags set
 
@@ -59,18 +144,21 @@ std::vector<unsigned char> OpenFlowMessage::createFlowRequest()
 	flow_request.out_port = 0xFFFF; // Match all ports. HTONL not necessary since all bytes are the same here.
 #endif
 
-	// Create an unsigned char (blessed casting type) vector to store our struct
-	std::vector<unsigned char> buffer(sizeof(ofp_stats_request) + sizeof(ofp_flow_stats_request));
 	// Store the first 12 bytes (ofp_stats_request struct, byte 1-12)
-	std::memcpy(buffer.data(), &request, sizeof(ofp_stats_request));
+	std::memcpy(out.data(), &request, sizeof(ofp_stats_request));
 	// Store the next 44 bytes (ofp_flow_stats_request struct, byte 13-56)
-	std::memcpy(buffer.data() + sizeof(ofp_stats_request), &flow_request, sizeof(ofp_flow_stats_request));
+	std::memcpy(out.data() + sizeof(ofp_stats_request), &flow_request, sizeof(ofp_flow_stats_request));
 
-	return buffer;
+	return length;
 }
 
-std::vector<unsigned char> OpenFlowMessage::createFeaturesReply(uint32_t XID)
+size_t OpenFlowMessage::encodeFeaturesReply(std::span<unsigned char> out, uint32_t XID)
 {
+	// Ensure the caller's buffer can hold the message
+	if (out.size() < sizeof(ofp_switch_features)) {
+		return 0;
+	}
+
 	// Initialize ofp_switch_features struct
 	ofp_switch_features reply;
 	std::memset(&reply, 0, sizeof(reply));
@@ -90,15 +178,20 @@ std::vector<unsigned char> OpenFlowMessage::createFeaturesReply(uint32_t XID)
 	reply.actions = htonl(0xFFFF);
 #endif
 
-	// Create an unsigned char (blessed casting type) vector to store our struct
-	std::vector<unsigned char> buffer(sizeof(ofp_switch_features));
 	// Store the bytes (ofp_switch_features struct)
-	std::memcpy(buffer.data(), &reply, sizeof(ofp_switch_features));
+	std::memcpy(out.data(), &reply, sizeof(ofp_switch_features));
 
-	return buffer;
+	return sizeof(ofp_switch_features);
 }
 
-std::vector<unsigned char> OpenFlowMessage::createDescStatsReply(uint32_t XID) {
+size_t OpenFlowMessage::encodeDescStatsReply(std::span<unsigned char> out, uint32_t XID)
+{
+	// Ensure the caller's buffer can hold the message
+	const size_t length = sizeof(ofp_stats_reply) + sizeof(ofp_desc_stats);
+	if (out.size() < length) {
+		return 0;
+	}
+
     // Initialize the stats_reply struct
     ofp_stats_reply reply;
     std::memset(&reply, 0, sizeof(reply));
@@ -112,7 +205,7 @@ std::vector<unsigned char> OpenFlowMessage::createDescStatsReply(uint32_t XID) {
     reply.header.version = OFP_10;
     reply.header.type = OFPT_STATS_REPLY;
     reply.header.xid = htonl(XID);
-	reply.header.length = htons(sizeof(ofp_stats_reply) + sizeof(ofp_desc_stats));
+	reply.header.length = htons(length);
 
     // Set the stats reply type to OFPST_DESC
     reply.type = htons(OFPST_DESC);
@@ -126,18 +219,22 @@ std::vector<unsigned char> OpenFlowMessage::createDescStatsReply(uint32_t XID) {
     std::strncpy(desc.dp_desc, "BensingtonPath", sizeof(desc.dp_desc) - 1);
 #endif
 
-    // Create an unsigned char (blessed casting type) vector to store our struct
-	std::vector<unsigned char> buffer(sizeof(ofp_stats_reply) + sizeof(ofp_desc_stats));
 	// Store the bytes (ofp_stats_reply struct)
-	std::memcpy(buffer.data(), &reply, sizeof(ofp_stats_reply));
+	std::memcpy(out.data(), &reply, sizeof(ofp_stats_reply));
 	// Store the extra bytes (ofp_desc_stats struct)
-	std::memcpy(buffer.data() + sizeof(ofp_stats_reply), &desc, sizeof(ofp_desc_stats));
+	std::memcpy(out.data() + sizeof(ofp_stats_reply), &desc, sizeof(ofp_desc_stats));
 
-	return buffer;
+	return length;
 }
 
-std::vector<unsigned char> OpenFlowMessage::createFlowStatsReply(uint32_t XID)
+size_t OpenFlowMessage::encodeFlowStatsReply(std::span<unsigned char> out, uint32_t XID)
 {
+	// Ensure the caller's buffer can hold the message
+	const size_t length = sizeof(ofp_stats_reply) + sizeof(ofp_flow_stats);
+	if (out.size() < length) {
+		return 0;
+	}
+
 	// Initialize the stats_reply struct
     ofp_stats_reply reply;
     std::memset(&reply, 0, sizeof(reply));
@@ -151,25 +248,28 @@ std::vector<unsigned char> OpenFlowMessage::createFlowStatsReply(uint32_t XID)
     reply.header.version = OFP_10;
     reply.header.type = OFPT_STATS_REPLY;
     reply.header.xid = htonl(XID);
-	reply.header.length = htons(sizeof(ofp_stats_reply) + sizeof(ofp_flow_stats));
+	reply.header.length = htons(length);
 
     // Set the stats reply type to OFPST_FLOW
     reply.type = htons(OFPST_FLOW);
     reply.flags = 0; // No more replies (set OFPSF_REPLY_MORE if there are more parts)
 #endif
 
-    // Create an unsigned char (blessed casting type) vector to store our struct
-	std::vector<unsigned char> buffer(sizeof(ofp_stats_reply) + sizeof(ofp_flow_stats));
 	// Store the bytes (ofp_stats_reply struct)
-	std::memcpy(buffer.data(), &reply, sizeof(ofp_stats_reply));
-	// Store the extra bytes (ofp_desc_stats struct)
-	std::memcpy(buffer.data() + sizeof(ofp_stats_reply), &flow, sizeof(ofp_flow_stats));
+	std::memcpy(out.data(), &reply, sizeof(ofp_stats_reply));
+	// Store the extra bytes (ofp_flow_stats struct)
+	std::memcpy(out.data() + sizeof(ofp_stats_reply), &flow, sizeof(ofp_flow_stats));
 
-	return buffer;
+	return length;
 }
 
-std::vector<unsigned char> OpenFlowMessage::createBarrierReply(uint32_t XID)
+size_t OpenFlowMessage::encodeBarrierReply(std::span<unsigned char> out, uint32_t XID)
 {
+	// Ensure the caller's buffer can hold the message
+	if (out.size() < sizeof(ofp_header)) {
+		return 0;
+	}
+
     ofp_header header;
 	std::memset(&header, 0, sizeof(header));
 
@@ -180,27 +280,141 @@ std::vector<unsigned char> OpenFlowMessage::createBarrierReply(uint32_t XID)
 	header.length = htons(sizeof(ofp_header));
 	header.xid = htonl(XID);
 #endif
-	
+
+	// Store the first 8 bytes (ofp_header struct, byte 1-8)
+	std::memcpy(out.data(), &header, sizeof(ofp_header));
+
+	return sizeof(ofp_header);
+}
+
+std::span<unsigned char> OpenFlowMessage::scratch()
+{
+	// One buffer per thread -- the controller and flow handler threads both send replies
+	thread_local unsigned char buffer[OFP_SCRATCH_SIZE];
+	return std::span<unsigned char>(buffer, OFP_SCRATCH_SIZE);
+}
+
+std::vector<unsigned char> OpenFlowMessage::createHello(uint32_t XID)
+{
     // Create an unsigned char (blessed casting type) vector to store our struct
 	std::vector<unsigned char> buffer(sizeof(ofp_header));
-	// Store the first 8 bytes (ofp_header struct, byte 1-8)
-	std::memcpy(buffer.data(), &header, sizeof(ofp_header));
+	encodeHello(buffer, XID);
+	return buffer;
+}
 
+std::vector<unsigned char> OpenFlowMessage::createFlowRequest()
+{
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_stats_request) + sizeof(ofp_flow_stats_request));
+	encodeFlowRequest(buffer, 100 + (std::rand() % 4095 - 99)); // XID is not used in flow requests
 	return buffer;
 }
 
-std::vector<unsigned char> OpenFlowMessage::createFlowAdd(Flow f, uint32_t XID)
+std::vector<unsigned char> OpenFlowMessage::createFeaturesReply(uint32_t XID)
+{
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_switch_features));
+	encodeFeaturesReply(buffer, XID);
+	return buffer;
+}
+
+std::vector<unsigned char> OpenFlowMessage::createDescStatsReply(uint32_t XID)
+{
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_stats_reply) + sizeof(ofp_desc_stats));
+	encodeDescStatsReply(buffer, XID);
+	return buffer;
+}
+
+std::vector<unsigned char> OpenFlowMessage::createFlowStatsReply(uint32_t XID)
+{
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_stats_reply) + sizeof(ofp_flow_stats));
+	encodeFlowStatsReply(buffer, XID);
+	return buffer;
+}
+
+std::vector<unsigned char> OpenFlowMessage::createBarrierReply(uint32_t XID)
 {
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_header));
+	encodeBarrierReply(buffer, XID);
+	return buffer;
+}
+
+size_t OpenFlowMessage::encodeFlowMod(std::span<unsigned char> out, Flow f, uint16_t command, uint32_t XID)
+{
+	// Ensure the caller's buffer can hold the message and its single output action
+	const size_t length = sizeof(ofp_flow_mod) + sizeof(ofp_action_output);
+	if (out.size() < length) {
+		return 0;
+	}
+
+	// Rule prefix (e.g. 10.0.0.0/24) is already split into address and mask length
+	int maskLength = f.getPrefixLength();
+	if (maskLength < 0) {
+		loggyErr("[CCPDN-ERROR]: Flow has no valid rule prefix: " + f.flowToStr(false) + "\n");
+		return 0;
+	}
+	uint16_t outputPort = f.getOutPort();
+
 	// Initialize the flow_mod struct
 	ofp_flow_mod flow_mod;
 	std::memset(&flow_mod, 0, sizeof(flow_mod));
 
-	return std::vector<unsigned char>();
+	// Initialize the output action
+	ofp_action_output action;
+	std::memset(&action, 0, sizeof(action));
+
+#ifdef __unix__
+	// Set the OF header values
+	flow_mod.header.version = OFP_10;
+	flow_mod.header.type = OFPT_FLOW_MOD;
+	flow_mod.header.length = htons(length);
+	flow_mod.header.xid = htonl(XID);
+
+	// Match IPv4/TCP from the rule prefix, wildcard everything else (same match the FlowInterface builds)
+	uint32_t wildcards = OFPFW_ALL & ~(OFPFW_DL_TYPE | OFPFW_NW_PROTO | OFPFW_NW_SRC_MASK | OFPFW_NW_DST_MASK);
+	wildcards |= OFPFW_NW_DST_ALL | (static_cast<uint32_t>(32 - maskLength) << OFPFW_NW_SRC_SHIFT);
+	flow_mod.match.wildcards = htonl(wildcards);
+	flow_mod.match.dl_type = htons(0x0800);
+	flow_mod.match.nw_proto = 0x06;
+	flow_mod.match.nw_src = htonl(f.getPrefixAddress());
+
+	// Flow mod fields
+	flow_mod.command = htons(command);
+	flow_mod.priority = htons(OFP_DEFAULT_PRIORITY);
+	flow_mod.buffer_id = htonl(OFP_NO_BUFFER);
+	flow_mod.out_port = htons(OFPP_NONE);
+
+	// Forward matching traffic out of the port facing the next hop
+	action.type = htons(OFPAT_OUTPUT);
+	action.len = htons(sizeof(ofp_action_output));
+	action.port = htons(outputPort);
+#endif
+
+	// Store the bytes (ofp_flow_mod struct)
+	std::memcpy(out.data(), &flow_mod, sizeof(ofp_flow_mod));
+	// Store the extra bytes (ofp_action_output struct)
+	std::memcpy(out.data() + sizeof(ofp_flow_mod), &action, sizeof(ofp_action_output));
+
+	return length;
+}
+
+std::vector<unsigned char> OpenFlowMessage::createFlowAdd(Flow f, uint32_t XID)
+{
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_flow_mod) + sizeof(ofp_action_output));
+	buffer.resize(encodeFlowMod(buffer, f, OFPFC_ADD, XID));
+	return buffer;
 }
 
 std::vector<unsigned char> OpenFlowMessage::createFlowRemove(Flow f, uint32_t XID)
 {
-    return std::vector<unsigned char>();
+	// Create an unsigned char (blessed casting type) vector to store our struct
+	std::vector<unsigned char> buffer(sizeof(ofp_flow_mod) + sizeof(ofp_action_output));
+	buffer.resize(encodeFlowMod(buffer, f, OFPFC_DELETE, XID));
+	return buffer;
 }
 
 std::string OpenFlowMessage::ipToString(uint32_t ip)
@@ -223,8 +437,9 @@ std::string OpenFlowMessage::getRulePrefix(uint32_t wildcards, uint32_t srcIP) /
 	// Output string. This method expects host-endian order
 	std::string output = "";
 
-	// Calculate mask length
-    int mask_length = 32 - ((wildcards >> 8) & 0xFF);
+    // Calculate mask length -- 6-bit field, anything past 32 wildcards the whole address
+    int wildcard_bits = (wildcards & OFPFW_NW_SRC_MASK) >> OFPFW_NW_SRC_SHIFT;
+    int mask_length = wildcard_bits >= 32 ? 0 : 32 - wildcard_bits;
 	
 	// get ip address from nw_src
 	std::string ip_str = ipToString(srcIP);
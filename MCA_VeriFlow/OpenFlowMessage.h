@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <cstring>
+#include <span>
 #include "Flow.h"
 #include "Log.h"
 #ifdef __unix__
@@ -21,6 +22,9 @@
 // Define CCPDN identifier
 #define CCPDN_IDENTIFIER 0x1CCC56BA9ABCDEF0
 
+// Size of the per-thread encode buffer -- large enough for any message we build
+#define OFP_SCRATCH_SIZE 2048
+
 // OpenFlow macros
 #ifdef SWIG
 #define OFP_ASSERT(EXPR)        /* SWIG can't handle OFP_ASSERT. */
@@ -162,7 +166,45 @@ struct ofp_action_header { // Unused but required field
 };
 OFP_ASSERT(sizeof(struct ofp_action_header) == 10);
 
-// ADD OFP_ACTION_OUTPUT struct
+// 8 bytes -- // OUTPUT ACTION, REQUIRED FOR FLOW MODS
+struct ofp_action_output {
+	uint16_t type; /* OFPAT_OUTPUT. */
+	uint16_t len; /* Length is 8. */
+	uint16_t port; /* Output port. */
+	uint16_t max_len; /* Max length to send to controller. */
+};
+OFP_ASSERT(sizeof(struct ofp_action_output) == 8);
+
+enum ofp_action_type {
+	OFPAT_OUTPUT /* Output to switch port. */
+};
+
+// Fake output ports
+#define OFPP_NONE 0xFFFF
+
+// Default priority/buffer values for flow mods (matches POX defaults)
+#define OFP_DEFAULT_PRIORITY 0x8000
+#define OFP_NO_BUFFER 0xFFFFFFFF
+
+// Flow wildcards -- IP source/destination use a 6-bit count of wildcarded low-order bits
+enum ofp_flow_wildcards {
+	OFPFW_IN_PORT = 1 << 0, /* Switch input port. */
+	OFPFW_DL_VLAN = 1 << 1, /* VLAN id. */
+	OFPFW_DL_SRC = 1 << 2, /* Ethernet source address. */
+	OFPFW_DL_DST = 1 << 3, /* Ethernet destination address. */
+	OFPFW_DL_TYPE = 1 << 4, /* Ethernet frame type. */
+	OFPFW_NW_PROTO = 1 << 5, /* IP protocol. */
+	OFPFW_TP_SRC = 1 << 6, /* TCP/UDP source port. */
+	OFPFW_TP_DST = 1 << 7, /* TCP/UDP destination port. */
+	OFPFW_NW_SRC_SHIFT = 8,
+	OFPFW_NW_SRC_MASK = 0x3F << 8,
+	OFPFW_NW_DST_SHIFT = 14,
+	OFPFW_NW_DST_MASK = 0x3F << 14,
+	OFPFW_NW_DST_ALL = 32 << 14,
+	OFPFW_DL_VLAN_PCP = 1 << 20, /* VLAN priority. */
+	OFPFW_NW_TOS = 1 << 21, /* IP ToS (DSCP field, 6 bits). */
+	OFPFW_ALL = ((1 << 22) - 1) /* Wildcard all fields. */
+};
 
 // 40 bytes -- // MATCH STRUCT -- REQUIRED FOR FLOWS
 struct ofp_match { // Struct used for matching SRC IP, next hop & rule prefix
@@ -325,8 +367,68 @@ struct ofp_desc_stats {
 };
 OFP_ASSERT(sizeof(struct ofp_desc_stats) == 1056);
 
+/// Read-only, non-owning view of a single OpenFlow message inside a borrowed byte buffer.
+///
+/// The view never copies or byte-swaps the underlying bytes -- header fields are decoded to
+/// host order on read, and typed accessors return nullptr unless the message type matches and
+/// the declared length covers the whole struct. The same buffer can be parsed any number of times.
+
+class OpenFlowView {
+	public:
+		// Views the message at the front of data (bytes past its declared length are ignored)
+		explicit OpenFlowView(std::span<const uint8_t> data);
+
+		// True if a full header is present and the declared length fits within the buffer
+		bool valid() const { return isValid; }
+
+		// Header fields in host-endian order
+		uint8_t version() const;
+		uint8_t type() const;
+		uint16_t length() const;
+		uint32_t xid() const;
+
+		// Exactly the bytes of this message
+		std::span<const uint8_t> bytes() const { return message; }
+
+		// Bytes following a fixed-size struct of the given size (empty if the message is shorter)
+		std::span<const uint8_t> body(size_t fixedSize) const;
+
+		// Typed accessors -- fields remain in network order
+		const ofp_header* header() const;
+		const ofp_flow_mod* flowMod() const;
+		const ofp_flow_removed* flowRemoved() const;
+		const ofp_stats_request* statsRequest() const;
+		const ofp_stats_reply* statsReply() const;
+
+	private:
+		template <typename T>
+		const T* as(uint8_t expectedType) const {
+			if (!isValid || type() != expectedType || message.size() < sizeof(T)) {
+				return nullptr;
+			}
+			return reinterpret_cast<const T*>(message.data());
+		}
+
+		std::span<const uint8_t> message;
+		bool isValid;
+};
+
 class OpenFlowMessage {
 	public:
+		// Message encoding -- writes into out and returns the bytes written, or 0 if out is too small.
+		// Nothing is allocated, so replies can be built straight into scratch() and sent from there.
+		static size_t encodeHello(std::span<unsigned char> out, uint32_t XID);
+		static size_t encodeFlowRequest(std::span<unsigned char> out, uint32_t XID);
+		static size_t encodeFeaturesReply(std::span<unsigned char> out, uint32_t XID);
+		static size_t encodeDescStatsReply(std::span<unsigned char> out, uint32_t XID);
+		static size_t encodeFlowStatsReply(std::span<unsigned char> out, uint32_t XID);
+		static size_t encodeBarrierReply(std::span<unsigned char> out, uint32_t XID);
+		// Flow mods -- match TCP/IPv4 traffic from the flow's rule prefix, output on the port set by Flow::setDPID
+		static size_t encodeFlowMod(std::span<unsigned char> out, Flow f, uint16_t command, uint32_t XID);
+
+		// Per-thread encode buffer of OFP_SCRATCH_SIZE bytes, reused by every call on the same thread
+		static std::span<unsigned char> scratch();
+
 		// Message creation -- all XIDS are expected to be passed in as host-endian order
 		static std::vector<unsigned char> createHello(uint32_t XID);
 		static std::vector<unsigned char> createFlowRequest();
@@ -0,0 +1,75 @@
+#include "PacketRing.h"
+
+PacketRing::PacketRing(size_t capacity, size_t slotSize)
+{
+	// Round capacity up to a power of two so indices can be masked instead of divided
+	size_t roundedCapacity = 1;
+	while (roundedCapacity < capacity) {
+		roundedCapacity <<= 1;
+	}
+
+	// Preallocate every slot's buffer up front
+	slots.resize(roundedCapacity);
+	for (TimestampPacket& slot : slots) {
+		slot.data.reserve(slotSize);
+	}
+
+	mask = roundedCapacity - 1;
+	head.store(0, std::memory_order_relaxed);
+	tail.store(0, std::memory_order_relaxed);
+	dropped.store(0, std::memory_order_relaxed);
+}
+
+PacketRing::~PacketRing()
+{
+}
+
+bool PacketRing::push(const byte* data, size_t length)
+{
+	size_t currentTail = tail.load(std::memory_order_relaxed);
+
+	// Ring is full -- consumer hasn't caught up yet
+	if (currentTail - head.load(std::memory_order_acquire) > mask) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// Copy into the slot's existing buffer (only grows if the payload exceeds its capacity)
+	TimestampPacket& slot = slots[currentTail & mask];
+	slot.timestamp = std::chrono::high_resolution_clock::now();
+	slot.data.assign(data, data + length);
+
+	// Publish the slot to the consumer
+	tail.store(currentTail + 1, std::memory_order_release);
+	return true;
+}
+
+bool PacketRing::pop(TimestampPacket& out)
+{
+	size_t currentHead = head.load(std::memory_order_relaxed);
+
+	// Nothing published yet
+	if (currentHead == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	// Swap buffers so the slot keeps an allocation for the next push
+	TimestampPacket& slot = slots[currentHead & mask];
+	out.timestamp = slot.timestamp;
+	out.data.swap(slot.data);
+	slot.data.clear();
+
+	// Hand the slot back to the producer
+	head.store(currentHead + 1, std::memory_order_release);
+	return true;
+}
+
+bool PacketRing::empty() const
+{
+	return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+}
+
+size_t PacketRing::size() const
+{
+	return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
@@ -0,0 +1,55 @@
+#ifndef PACKETRING_H
+#define PACKETRING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+// Default ring dimensions -- slot count must be a power of two
+#define PACKET_RING_SLOTS 1024
+#define PACKET_SLOT_SIZE 2048
+
+typedef uint8_t byte;
+typedef std::vector<byte> packet;
+
+struct TimestampPacket {
+	std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
+	packet data;
+};
+
+/// Bounded single-producer/single-consumer queue of captured TCP payloads.
+///
+/// The pcap callback is the only producer and the flow handler thread is the only consumer.
+/// Every slot keeps its own byte buffer for the lifetime of the ring, so pushing a payload
+/// only copies bytes into memory that was already allocated. Packets are popped in arrival
+/// order, which is also timestamp order.
+
+class PacketRing {
+	public:
+		PacketRing(size_t capacity, size_t slotSize);
+		~PacketRing();
+
+		// Producer side -- returns false (and drops the payload) if the ring is full
+		bool push(const byte* data, size_t length);
+
+		// Consumer side -- swaps the oldest payload into out.data, returns false if empty
+		bool pop(TimestampPacket& out);
+
+		bool empty() const;
+		size_t size() const;
+		size_t capacity() const { return slots.size(); }
+		uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+	private:
+		std::vector<TimestampPacket> slots;
+		size_t mask;
+
+		// Head is only written by the consumer, tail only by the producer
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) std::atomic<size_t> tail;
+		std::atomic<uint64_t> dropped;
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PENDINGREQUESTS_H
+#define PENDINGREQUESTS_H
+
+#include <cstdint>
+#include <mutex>
+#include <future>
+#include <unordered_map>
+
+/// Outstanding requests to other CCPDN instances, keyed by the correlation ID carried in each Digest.
+///
+/// open() hands back a fresh ID and a future for the result; the CCPDN receive thread calls complete()
+/// with the ID echoed in the reply. Any number of requests can be in flight at once, and a reply only
+/// ever resolves the request it belongs to. ID 0 is never issued so it can mark uncorrelated digests.
+/// Each request records the topology index it was sent to, so losing that instance fails just its requests.
+
+template <typename T>
+class PendingRequests {
+	public:
+		PendingRequests() : nextID(0) {}
+
+		PendingRequests(const PendingRequests&) = delete;
+		PendingRequests& operator=(const PendingRequests&) = delete;
+
+		// Register a new request to destination, returns its correlation ID and stores its future in result
+		uint32_t open(int destination, std::future<T>& result) {
+			std::lock_guard<std::mutex> lock(mutex);
+			uint32_t id = ++nextID;
+			if (id == 0) {
+				id = ++nextID;
+			}
+
+			Request& request = pending[id];
+			request.destination = destination;
+			result = request.promise.get_future();
+			return id;
+		}
+
+		// Resolve a request with its reply, returns false if the ID is unknown (timed out or never sent)
+		bool complete(uint32_t id, T value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = pending.find(id);
+			if (it == pending.end()) {
+				return false;
+			}
+
+			it->second.promise.set_value(std::move(value));
+			pending.erase(it);
+			return true;
+		}
+
+		// Forget a request the caller stopped waiting for, so a late reply is dropped
+		void cancel(uint32_t id) {
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.erase(id);
+		}
+
+		// Resolve every outstanding request to destination with the same value (used when its connection is lost)
+		void completeAll(int destination, T value) {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto it = pending.begin(); it != pending.end();) {
+				if (it->second.destination == destination) {
+					it->second.promise.set_value(value);
+					it = pending.erase(it);
+				} else {
+					it++;
+				}
+			}
+		}
+
+		size_t size() const {
+			std::lock_guard<std::mutex> lock(mutex);
+			return pending.size();
+		}
+
+	private:
+		struct Request {
+			std::promise<T> promise;
+			int destination = -1;
+		};
+
+		mutable std::mutex mutex;
+		std::unordered_map<uint32_t, Request> pending;
+		uint32_t nextID;
+};
+
+#endif
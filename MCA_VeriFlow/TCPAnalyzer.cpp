@@ -1,7 +1,167 @@
 #include "TCPAnalyzer.h"
 #include "Controller.h" // for forward declaration
 
+#ifdef __linux__
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
 void TCPAnalyzer::updatePauseOutput(bool update)
 {
 	Controller::pauseOutput = update;
 }
+
+
+void TCPAnalyzer::ping()
+{
+	// Only the first ping since the last wakeup needs to take the lock and notify
+	if (!pingFlag.exchange(true)) {
+		{
+			std::lock_guard<std::mutex> lock(pingMutex);
+		}
+		pingCV.notify_one();
+	}
+}
+
+void TCPAnalyzer::waitForPing(std::atomic<bool>* run, std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> lock(pingMutex);
+	pingCV.wait_for(lock, timeout, [run]() {
+		return pingFlag.load() || !currentPackets.empty() || !*run;
+	});
+	pingFlag.store(false);
+}
+
+void TCPAnalyzer::enqueuePayload(const byte* data, size_t length)
+{
+	// Copy the messages straight into the next preallocated ring slot
+	if (!currentPackets.push(data, length)) {
+		loggyErr("[CCPDN-ERROR]: Packet queue full, dropped captured packet (" + std::to_string(currentPackets.droppedCount()) + " dropped so far)\n");
+		return;
+	}
+
+	// Give our other threads a notifier that they have packets to work on!
+	ping();
+}
+
+#ifdef __linux__
+bool TCPAnalyzer::startMmapCapture(const std::string& interface, const std::string& filterExp, std::atomic<bool>* run)
+{
+	// Raw packet socket bound to every protocol -- requires root/CAP_NET_RAW
+	int sock = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (sock < 0) {
+		loggy << "[CCPDN-ERROR]: Couldn't open packet socket: " << strerror(errno) << std::endl;
+		return false;
+	}
+
+	// Compile the capture filter with libpcap and attach it in the kernel, so we only wake for controller traffic
+	pcap_t* dead = pcap_open_dead(DLT_EN10MB, MMAP_MAX_SNAPLEN);
+	struct bpf_program filter;
+	if (dead == nullptr || pcap_compile(dead, &filter, filterExp.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1) {
+		loggy << "[CCPDN-ERROR]: Couldn't compile filter for mmap capture" << std::endl;
+		if (dead != nullptr) {
+			pcap_close(dead);
+		}
+		close(sock);
+		return false;
+	}
+	struct sock_fprog program;
+	program.len = filter.bf_len;
+	program.filter = reinterpret_cast<struct sock_filter*>(filter.bf_insns);
+	int attached = setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &program, sizeof(program));
+	pcap_freecode(&filter);
+	pcap_close(dead);
+	if (attached < 0) {
+		loggy << "[CCPDN-ERROR]: Couldn't attach capture filter: " << strerror(errno) << std::endl;
+		close(sock);
+		return false;
+	}
+
+	// Switch to TPACKET_V3 and request the receive ring
+	int version = TPACKET_V3;
+	if (setsockopt(sock, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+		loggy << "[CCPDN-ERROR]: TPACKET_V3 not supported: " << strerror(errno) << std::endl;
+		close(sock);
+		return false;
+	}
+
+	struct tpacket_req3 request;
+	std::memset(&request, 0, sizeof(request));
+	request.tp_block_size = MMAP_BLOCK_SIZE;
+	request.tp_block_nr = MMAP_BLOCK_COUNT;
+	request.tp_frame_size = MMAP_FRAME_SIZE;
+	request.tp_frame_nr = (MMAP_BLOCK_SIZE / MMAP_FRAME_SIZE) * MMAP_BLOCK_COUNT;
+	request.tp_retire_blk_tov = MMAP_BLOCK_TIMEOUT_MS;
+	if (setsockopt(sock, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0) {
+		loggy << "[CCPDN-ERROR]: Couldn't create packet ring: " << strerror(errno) << std::endl;
+		close(sock);
+		return false;
+	}
+
+	size_t ringSize = static_cast<size_t>(request.tp_block_size) * request.tp_block_nr;
+	uint8_t* ring = static_cast<uint8_t*>(mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, sock, 0));
+	if (ring == MAP_FAILED) {
+		loggy << "[CCPDN-ERROR]: Couldn't map packet ring: " << strerror(errno) << std::endl;
+		close(sock);
+		return false;
+	}
+
+	// Bind to the capture interface
+	struct sockaddr_ll address;
+	std::memset(&address, 0, sizeof(address));
+	address.sll_family = AF_PACKET;
+	address.sll_protocol = htons(ETH_P_ALL);
+	address.sll_ifindex = if_nametoindex(interface.c_str());
+	if (address.sll_ifindex == 0 || bind(sock, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) < 0) {
+		loggy << "[CCPDN-ERROR]: Couldn't bind packet socket to " << interface << std::endl;
+		munmap(ring, ringSize);
+		close(sock);
+		return false;
+	}
+
+	// Loopback delivers every frame twice (outgoing + incoming), only keep one copy like libpcap does
+	bool skipOutgoing = (interface == "lo");
+
+	loggy << "[CCPDN]: Successfully started mmap packet capture\n";
+	updatePauseOutput(false);
+
+	unsigned int blockIndex = 0;
+	while (*run) {
+		struct tpacket_block_desc* block = reinterpret_cast<struct tpacket_block_desc*>(ring + static_cast<size_t>(blockIndex) * request.tp_block_size);
+
+		// Block still owned by the kernel -- sleep until it retires one (timeout lets us notice *run)
+		if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+			struct pollfd descriptor;
+			descriptor.fd = sock;
+			descriptor.events = POLLIN | POLLERR;
+			descriptor.revents = 0;
+			poll(&descriptor, 1, 100);
+			continue;
+		}
+
+		// Parse every frame in place on the ring's memory
+		struct tpacket3_hdr* frame = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt);
+		for (uint32_t i = 0; i < block->hdr.bh1.num_pkts; i++) {
+			const struct sockaddr_ll* link = reinterpret_cast<const struct sockaddr_ll*>(reinterpret_cast<uint8_t*>(frame) + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+			if (!(skipOutgoing && link->sll_pkttype == PACKET_OUTGOING)) {
+				handleFrame(reinterpret_cast<const u_char*>(frame) + frame->tp_mac, frame->tp_snaplen);
+			}
+			frame = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<uint8_t*>(frame) + frame->tp_next_offset);
+		}
+
+		// Return the block to the kernel and move on
+		__atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+		blockIndex = (blockIndex + 1) % request.tp_block_nr;
+	}
+
+	munmap(ring, ringSize);
+	close(sock);
+	return true;
+}
+#endif
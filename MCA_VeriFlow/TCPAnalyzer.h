@@ -11,40 +11,51 @@
 #include "Log.h"
 #include "OpenFlowMessage.h"
 #include "Flow.h"
+#include "PacketRing.h"
+#include "TCPReassembler.h"
 #include <chrono>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
 
 #ifdef __unix__
 #include <pcap.h>
 #endif
 
-typedef uint8_t byte;
-typedef std::vector<byte> packet;
-
-struct TimestampPacket {
-	std::chrono::time_point<std::chrono::high_resolution_clock> timestamp;
-	packet data;
-
-	const bool smallerTime(const TimestampPacket other) const {
-		return timestamp < other.timestamp;
-	}
-};
+// TPACKET_V3 ring dimensions -- 16 blocks of 1 MB, each retired to userspace after at most 10 ms
+#define MMAP_BLOCK_SIZE (1 << 20)
+#define MMAP_BLOCK_COUNT 16
+#define MMAP_FRAME_SIZE 2048
+#define MMAP_BLOCK_TIMEOUT_MS 10
+// Filter accept length -- the kernel truncates to what the BPF program returns, so keep whole loopback frames
+#define MMAP_MAX_SNAPLEN 262144
 
 class TCPAnalyzer {
 
 	public:
 
-		static bool pingFlag;
-		static std::vector<TimestampPacket> currentPackets;
-		static std::mutex currentPacketsMutex;
+		TCPAnalyzer() {
+			// Only whole OpenFlow messages leave the reassembler and enter the packet queue
+			reassembler.setEmitCallback(&TCPAnalyzer::enqueuePayload);
+		}
+
+		static std::atomic<bool> pingFlag;
+		static PacketRing currentPackets;
+		static std::mutex pingMutex;
+		static std::condition_variable pingCV;
+
+		// Wake the flow handler thread -- called whenever it has new work
+		static void ping();
+		// Block until pinged, a packet is queued, run is cleared or the timeout passes
+		static void waitForPing(std::atomic<bool>* run, std::chrono::milliseconds timeout);
+		// Queue reassembled OpenFlow messages for the flow handler thread
+		static void enqueuePayload(const byte* data, size_t length);
 
 		// Thread method
-		void thread(bool *run, std::string controllerPort) {
+		void thread(std::atomic<bool>* run, std::string controllerPort) {
 			while (*run) {
-				pingFlag = false;
-				currentPackets.clear();
+				reassembler.reset();
 				std::this_thread::sleep_for(std::chrono::milliseconds(100));
 				loggy << "[CCPDN]: Starting LibPCap thread...\n";
 				startPacketCapture("lo", "tcp port " + controllerPort, run);
@@ -56,47 +67,75 @@ class TCPAnalyzer {
 #ifdef __unix__
 	void packetHandler(const struct pcap_pkthdr* pkthdr, const u_char* packet) {
 
-		// Give our other threads a notifier if they have packets to work on!
-		if (currentPackets.size() > 0) {
-			pingFlag = true;
-		}
-
 		// Ensure valid data
 		if (pkthdr == nullptr || packet == nullptr) {
 			return;
 		}
 
-		int ETHERNET_HEADER_SIZE = 14;
+		handleFrame(packet, pkthdr->caplen);
+	}
+#endif
+
+	// Parse a captured ethernet frame in place and feed its TCP segment to the reassembler
+	void handleFrame(const u_char* packet, uint32_t caplen) {
+
+		constexpr uint32_t ETHERNET_HEADER_SIZE = 14;
+		if (caplen < ETHERNET_HEADER_SIZE + 20) {
+			return;
+		}
+
 		// Extract IP Frame
 		const u_char* ipHeader = packet + ETHERNET_HEADER_SIZE;
-		int IP_HEADER_SIZE = ((ipHeader[0] & 0x0F) * 4);
+		uint32_t IP_HEADER_SIZE = ((ipHeader[0] & 0x0F) * 4);
+		int IP_TOTAL_SIZE = (ipHeader[2] << 8) | ipHeader[3];
 
 		// Extract TCP Frame
 		const u_char* tcpHeader = ipHeader + (IP_HEADER_SIZE);
-		int TCP_HEADER_SIZE = ((tcpHeader[12] & 0xF0) >> 4) * 4;
-		int TOTAL_PAYLOAD_SIZE = pkthdr->len - (ETHERNET_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE);
-
-		// Extract TCP Payload as vector of bytes
-		std::vector<byte> payload(tcpHeader + TCP_HEADER_SIZE, tcpHeader + pkthdr->len - ETHERNET_HEADER_SIZE - IP_HEADER_SIZE);
-
-		if (payload.empty()) {
+		if (caplen < ETHERNET_HEADER_SIZE + IP_HEADER_SIZE + 20) {
 			return;
 		}
-
-		// Create a timestamped packet
-		TimestampPacket tsPacket = {std::chrono::high_resolution_clock::now(), payload};
-
-		// Utilize parsing methods from controller, and update controller remotely
-		{
-			// Lock mutex to ensure thread safety
-			std::lock_guard<std::mutex> lock(currentPacketsMutex);
-			currentPackets.push_back(tsPacket);
-			pingFlag = true;
+		uint32_t TCP_HEADER_SIZE = ((tcpHeader[12] & 0xF0) >> 4) * 4;
+
+		// Use the IP length so ethernet padding isn't mistaken for payload, and never read past the capture
+		// (signed, either can come out negative for a malformed or truncated frame)
+		int TOTAL_PAYLOAD_SIZE = IP_TOTAL_SIZE - static_cast<int>(IP_HEADER_SIZE + TCP_HEADER_SIZE);
+		int CAPTURED_PAYLOAD_SIZE = static_cast<int>(caplen) - static_cast<int>(ETHERNET_HEADER_SIZE + IP_HEADER_SIZE + TCP_HEADER_SIZE);
+		if (TOTAL_PAYLOAD_SIZE > CAPTURED_PAYLOAD_SIZE) {
+			TOTAL_PAYLOAD_SIZE = CAPTURED_PAYLOAD_SIZE;
+		}
+		if (TOTAL_PAYLOAD_SIZE < 0) {
+			TOTAL_PAYLOAD_SIZE = 0;
 		}
+
+		// Identify the stream direction and position of this segment
+		StreamKey key;
+		std::memcpy(&key.srcIP, ipHeader + 12, sizeof(uint32_t));
+		std::memcpy(&key.dstIP, ipHeader + 16, sizeof(uint32_t));
+		key.srcIP = ntohl(key.srcIP);
+		key.dstIP = ntohl(key.dstIP);
+		key.srcPort = (tcpHeader[0] << 8) | tcpHeader[1];
+		key.dstPort = (tcpHeader[2] << 8) | tcpHeader[3];
+		uint32_t seq = (static_cast<uint32_t>(tcpHeader[4]) << 24) | (tcpHeader[5] << 16) | (tcpHeader[6] << 8) | tcpHeader[7];
+		uint8_t flags = tcpHeader[13];
+
+		// Reassembler calls enqueuePayload() for every run of complete OpenFlow messages
+		reassembler.addSegment(key, seq, flags, tcpHeader + TCP_HEADER_SIZE, TOTAL_PAYLOAD_SIZE);
 	}
+
+#ifdef __linux__
+	// Capture straight out of a TPACKET_V3 memory-mapped ring, returns false if the ring couldn't be set up
+	bool startMmapCapture(const std::string& interface, const std::string& filterExp, std::atomic<bool>* run);
 #endif
 
-	void startPacketCapture(const std::string& interface, const std::string& filterExp, bool* run) {
+	void startPacketCapture(const std::string& interface, const std::string& filterExp, std::atomic<bool>* run) {
+#ifdef __linux__
+		// Prefer the zero-copy mmap ring, fall back to libpcap if it isn't available
+		if (startMmapCapture(interface, filterExp, run)) {
+			loggy << "[CCPDN]: Packet capture complete\n";
+			return;
+		}
+		loggy << "[CCPDN]: Falling back to libpcap packet capture\n";
+#endif
 #ifdef __unix
 		char errbuf[PCAP_ERRBUF_SIZE];
 		pcap_t* handle;
@@ -134,11 +173,6 @@ class TCPAnalyzer {
 		// Create thread loop
 		while (*run) {
 
-			// Give our other threads a notifier if they have packets to work on!
-			if (currentPackets.size() > 0) {
-				pingFlag = true;
-			}
-
 			// Capture packets
 			pcap_loop(handle, 0, [](u_char* user, const struct pcap_pkthdr* pkthdr, const u_char* packet) {
 				TCPAnalyzer* analyzer = reinterpret_cast<TCPAnalyzer*>(user);
@@ -155,6 +189,7 @@ class TCPAnalyzer {
 	}
 		
 	private:
+		TCPReassembler reassembler;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "TCPReassembler.h"
+#include "OpenFlowMessage.h"
+
+// Signed distance between two sequence numbers (handles 32-bit wraparound)
+static int32_t seqDiff(uint32_t a, uint32_t b)
+{
+	return static_cast<int32_t>(a - b);
+}
+
+TCPReassembler::TCPReassembler()
+{
+	streams.clear();
+	emit = nullptr;
+}
+
+TCPReassembler::~TCPReassembler()
+{
+}
+
+void TCPReassembler::addSegment(const StreamKey& key, uint32_t seq, uint8_t flags, const byte* payload, size_t length)
+{
+	// Connection reset -- whatever we were holding for it is abandoned
+	if (flags & TCP_FLAG_RST) {
+		streams.erase(key);
+		return;
+	}
+
+	// Data can ride along with a FIN, emit it before the stream goes away
+	addPayload(streams[key], seq, flags, payload, length);
+	if (flags & TCP_FLAG_FIN) {
+		streams.erase(key);
+	}
+}
+
+void TCPReassembler::addPayload(TCPStream& stream, uint32_t seq, uint8_t flags, const byte* payload, size_t length)
+{
+	// New connection -- first data byte follows the SYN
+	if (flags & TCP_FLAG_SYN) {
+		resync(stream);
+		stream.synced = true;
+		stream.nextSeq = seq + 1;
+		return;
+	}
+
+	if (length == 0 || payload == nullptr) {
+		return;
+	}
+
+	// Capture started mid-connection (or we lost our place) -- assume this segment starts a message
+	if (!stream.synced) {
+		stream.synced = true;
+		stream.nextSeq = seq;
+	}
+
+	int32_t offset = seqDiff(seq, stream.nextSeq);
+
+	// Segment lies ahead of what we have -- hold it until the gap is filled
+	if (offset > 0) {
+		if (stream.pending.find(seq) == stream.pending.end()) {
+			stream.pending[seq] = std::vector<byte>(payload, payload + length);
+			stream.pendingBytes += length;
+		}
+		if (stream.pendingBytes > MAX_PENDING_STREAM_BYTES) {
+			loggyErr("[CCPDN-ERROR]: TCP stream gap never filled, resynchronizing\n");
+			resync(stream);
+		}
+		return;
+	}
+
+	// Retransmission or overlap -- skip bytes we've already consumed
+	size_t overlap = static_cast<size_t>(-offset);
+	if (overlap >= length) {
+		return;
+	}
+
+	payload += overlap;
+	length -= overlap;
+
+	// Fast path -- nothing buffered, so complete messages can be emitted straight from the caller's memory
+	if (stream.buffer.empty() && stream.pending.empty()) {
+		bool valid = true;
+		size_t complete = completeLength(payload, length, valid);
+		if (complete > 0 && emit) {
+			emit(payload, complete);
+		}
+		if (!valid) {
+			resync(stream);
+			return;
+		}
+		stream.nextSeq += static_cast<uint32_t>(complete);
+		payload += complete;
+		length -= complete;
+		if (length == 0) {
+			return;
+		}
+	}
+
+	appendInOrder(stream, payload, length);
+	drainPending(stream);
+	emitMessages(stream);
+}
+
+void TCPReassembler::reset()
+{
+	streams.clear();
+}
+
+void TCPReassembler::appendInOrder(TCPStream& stream, const byte* payload, size_t length)
+{
+	stream.buffer.insert(stream.buffer.end(), payload, payload + length);
+	stream.nextSeq += static_cast<uint32_t>(length);
+}
+
+void TCPReassembler::drainPending(TCPStream& stream)
+{
+	// Keep pulling held segments that now touch (or overlap) the end of the stream
+	bool progress = true;
+	while (progress && !stream.pending.empty()) {
+		progress = false;
+		for (auto it = stream.pending.begin(); it != stream.pending.end(); ++it) {
+			int32_t offset = seqDiff(it->first, stream.nextSeq);
+			if (offset > 0) {
+				continue;
+			}
+
+			size_t overlap = static_cast<size_t>(-offset);
+			if (overlap < it->second.size()) {
+				appendInOrder(stream, it->second.data() + overlap, it->second.size() - overlap);
+			}
+			stream.pendingBytes -= it->second.size();
+			stream.pending.erase(it);
+			progress = true;
+			break;
+		}
+	}
+}
+
+size_t TCPReassembler::completeLength(const byte* data, size_t length, bool& valid)
+{
+	// Walk whole messages from the front of the data
+	size_t complete = 0;
+	valid = true;
+	while (length - complete >= sizeof(ofp_header)) {
+		const ofp_header* header = reinterpret_cast<const ofp_header*>(data + complete);
+		uint16_t msgLength = ntohs(header->length);
+
+		// Not an OpenFlow header -- we can't find message boundaries in this stream anymore
+		if (header->version != OFP_10 || header->type > OFPT_QUEUE_GET_CONFIG_REPLY || msgLength < sizeof(ofp_header)) {
+			valid = false;
+			break;
+		}
+
+		// Wait for the rest of this message
+		if (length - complete < msgLength) {
+			break;
+		}
+		complete += msgLength;
+	}
+
+	return complete;
+}
+
+void TCPReassembler::emitMessages(TCPStream& stream)
+{
+	bool valid = true;
+	size_t complete = completeLength(stream.buffer.data(), stream.buffer.size(), valid);
+
+	// Hand every complete message over in one go
+	if (complete > 0 && emit) {
+		emit(stream.buffer.data(), complete);
+	}
+
+	if (!valid) {
+		resync(stream);
+		return;
+	}
+
+	// Keep the partial tail for the next segment
+	stream.buffer.erase(stream.buffer.begin(), stream.buffer.begin() + complete);
+}
+
+void TCPReassembler::resync(TCPStream& stream)
+{
+	stream.synced = false;
+	stream.buffer.clear();
+	stream.pending.clear();
+	stream.pendingBytes = 0;
+}
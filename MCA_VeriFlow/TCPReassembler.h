@@ -0,0 +1,81 @@
+#ifndef TCPREASSEMBLER_H
+#define TCPREASSEMBLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include "PacketRing.h"
+
+// TCP flag bits (byte 13 of the TCP header)
+#define TCP_FLAG_FIN 0x01
+#define TCP_FLAG_SYN 0x02
+#define TCP_FLAG_RST 0x04
+
+// Upper bound on out-of-order bytes held per stream before we give up and resync
+#define MAX_PENDING_STREAM_BYTES (1024 * 1024)
+
+// One direction of a TCP connection (host-endian addresses and ports)
+struct StreamKey {
+	uint32_t srcIP;
+	uint32_t dstIP;
+	uint16_t srcPort;
+	uint16_t dstPort;
+
+	bool operator==(const StreamKey& other) const {
+		return srcIP == other.srcIP && dstIP == other.dstIP && srcPort == other.srcPort && dstPort == other.dstPort;
+	}
+};
+
+struct StreamKeyHash {
+	size_t operator()(const StreamKey& k) const {
+		uint64_t ips = (static_cast<uint64_t>(k.srcIP) << 32) | k.dstIP;
+		uint32_t ports = (static_cast<uint32_t>(k.srcPort) << 16) | k.dstPort;
+		return std::hash<uint64_t>()(ips) ^ (std::hash<uint32_t>()(ports) << 1);
+	}
+};
+
+/// Rebuilds the OpenFlow byte stream of every captured TCP connection.
+///
+/// Segments are ordered by sequence number (retransmissions trimmed, gaps held until filled)
+/// and only whole ofp_header-delimited messages are handed to the emit callback, so a message
+/// split across segments is parsed once, after its last byte arrives.
+
+class TCPReassembler {
+	public:
+		typedef std::function<void(const byte* data, size_t length)> EmitCallback;
+
+		TCPReassembler();
+		~TCPReassembler();
+
+		void setEmitCallback(EmitCallback callback) { emit = callback; }
+
+		// Feed a single captured segment (payload may be empty for SYN/FIN/RST)
+		void addSegment(const StreamKey& key, uint32_t seq, uint8_t flags, const byte* payload, size_t length);
+
+		// Drop all stream state (used when packet capture restarts)
+		void reset();
+
+	private:
+		struct TCPStream {
+			bool synced = false;
+			uint32_t nextSeq = 0;
+			std::vector<byte> buffer;
+			std::map<uint32_t, std::vector<byte>> pending;
+			size_t pendingBytes = 0;
+		};
+
+		void addPayload(TCPStream& stream, uint32_t seq, uint8_t flags, const byte* payload, size_t length);
+		void appendInOrder(TCPStream& stream, const byte* payload, size_t length);
+		void drainPending(TCPStream& stream);
+		void emitMessages(TCPStream& stream);
+		static size_t completeLength(const byte* data, size_t length, bool& valid);
+		void resync(TCPStream& stream);
+
+		std::unordered_map<StreamKey, TCPStream, StreamKeyHash> streams;
+		EmitCallback emit;
+};
+
+#endif
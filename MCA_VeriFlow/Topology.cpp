@@ -1,5 +1,8 @@
 #include "Topology.h"
 
+// Returned by getNodeView when no node matches
+const Node Topology::emptyNode;
+
 // Copy-paste of MCA_VeriFlow splitInput function. Not efficient I know but im just trying to save time.
 std::vector<std::string> splitInputDupe(std::string input, std::vector<std::string> delimiters) {
 	std::vector<std::string> words;
@@ -137,6 +140,73 @@ std::string Topology::topology_toString(int index)
 	return output;
 }
 
+std::string Topology::deltas_toString(const std::vector<Delta>& deltas)
+{
+	// One change per line:
+	// N+ S|H IP:link,link -- node added (switch or host)
+	// N- IP               -- node removed
+	// L+ IP neighbour     -- link added
+	// L- IP neighbour     -- link removed
+	std::string output;
+	for (const Delta& delta : deltas) {
+		switch (delta.op) {
+			case Delta::NODE_ADD:
+				output += std::string("N+ ") + (delta.isSwitch ? "S " : "H ") + delta.IP + ":";
+				for (int i = 0; i < delta.links.size(); i++) {
+					output += (i > 0 ? "," : "") + delta.links[i];
+				}
+				break;
+			case Delta::NODE_REMOVE:
+				output += "N- " + delta.IP;
+				break;
+			case Delta::LINK_ADD:
+			case Delta::LINK_REMOVE:
+				output += (delta.op == Delta::LINK_ADD ? "L+ " : "L- ") + delta.IP + " " + (delta.links.empty() ? "" : delta.links.front());
+				break;
+		}
+		output += "\n";
+	}
+	return output;
+}
+
+bool Topology::string_toDeltas(const std::string& payload, std::vector<Delta>& deltas)
+{
+	deltas.clear();
+	std::string line;
+	std::istringstream stream(payload);
+
+	while (std::getline(stream, line)) {
+		if (line.empty()) {
+			continue;
+		}
+
+		std::vector<std::string> args = splitInputDupe(line, { ":", ",", " " });
+		if (args.size() < 2) {
+			return false;
+		}
+
+		Delta delta;
+		delta.isSwitch = false;
+		if (args[0] == "N+" && args.size() >= 3 && (args[1] == "S" || args[1] == "H")) {
+			delta.op = Delta::NODE_ADD;
+			delta.isSwitch = (args[1] == "S");
+			delta.IP = args[2];
+			delta.links.assign(args.begin() + 3, args.end());
+		} else if (args[0] == "N-") {
+			delta.op = Delta::NODE_REMOVE;
+			delta.IP = args[1];
+		} else if ((args[0] == "L+" || args[0] == "L-") && args.size() == 3) {
+			delta.op = (args[0] == "L+") ? Delta::LINK_ADD : Delta::LINK_REMOVE;
+			delta.IP = args[1];
+			delta.links.push_back(args[2]);
+		} else {
+			return false;
+		}
+		deltas.push_back(delta);
+	}
+	return true;
+}
+
 bool Topology::addNode(Node node)
 {
 	std::vector<Node> newTopology;
@@ -152,54 +222,270 @@ bool Topology::addNode(Node node)
 	}
 
 	// Add the node to the topology
-	topologyList[node.getTopologyID()].push_back(node);
+	int index = node.getTopologyID();
+	topologyList[index].push_back(node);
+
+	// Record where it landed, the new node may be a neighbour of existing links
+	indexNode(index, (int)topologyList[index].size() - 1);
+	invalidateAdjacency();
+	refreshAdjacency();
+
+	// Log it so peers can pick it up as a delta
+	Delta delta;
+	delta.op = Delta::NODE_ADD;
+	delta.isSwitch = node.isSwitch();
+	delta.IP = node.getIP();
+	delta.links = node.getLinks();
+	recordDelta(index, delta);
 
 	return true;
 }
 
-Node Topology::getNodeByIP(std::string IP)
+void Topology::replaceTopology(int index, std::vector<Node> nodes)
 {
-	// Iterate through all topologies
-	for (int i = 0; i < topologyList.size(); i++) {
-		// Iterate through all nodes in the topology
-		for (int j = 0; j < topologyList[i].size(); j++) {
-			// If the IP matches, return the node
-			if (topologyList[i][j].getIP() == IP) {
-				return topologyList[i][j];
+	if (index < 0) {
+		return;
+	}
+
+	// If the topology ID doesn't exist, create new topologies until it does
+	while (index >= topologyList.size()) {
+		topologyList.push_back(std::vector<Node>());
+	}
+
+	// Only the replaced topology's entries change, every other topology keeps its index
+	unindexTopology(index);
+	topologyList[index] = std::move(nodes);
+	indexTopology(index);
+	invalidateAdjacency();
+	refreshAdjacency();
+	restartChangeLog(index);
+}
+
+bool Topology::applyDelta(int index, const Delta& delta)
+{
+	if (index < 0 || (index >= topologyList.size() && delta.op != Delta::NODE_ADD)) {
+		return false;
+	}
+
+	NodeLocation location;
+	bool found = findLocation(delta.IP, index, location);
+
+	switch (delta.op) {
+		case Delta::NODE_ADD: {
+			while (index >= topologyList.size()) {
+				topologyList.push_back(std::vector<Node>());
+			}
+
+			Node node(index, delta.isSwitch, delta.IP, delta.links);
+			if (found) {
+				// Already present -- same IP, so its index entries still hold
+				topologyList[index][location.second] = node;
+			} else {
+				topologyList[index].push_back(node);
+				indexNode(index, (int)topologyList[index].size() - 1);
+			}
+			invalidateAdjacency();
+			break;
+		}
+		case Delta::NODE_REMOVE: {
+			if (!found) {
+				return false;
+			}
+
+			// Move the last node into the gap so only the two nodes involved are reindexed
+			std::vector<Node>& nodes = topologyList[index];
+			int position = location.second;
+			int last = (int)nodes.size() - 1;
+			unindexNode(index, position);
+			if (position != last) {
+				unindexNode(index, last);
+				nodes[position] = nodes[last];
+			}
+			nodes.pop_back();
+			if (position != last) {
+				indexNode(index, position);
+			}
+			invalidateAdjacency();
+			break;
+		}
+		case Delta::LINK_ADD:
+		case Delta::LINK_REMOVE: {
+			if (!found || delta.links.empty()) {
+				return false;
 			}
+
+			Node& node = topologyList[index][location.second];
+			bool changed = (delta.op == Delta::LINK_ADD) ? node.addLink(delta.links.front()) : node.removeLink(delta.links.front());
+			if (!changed) {
+				return false;
+			}
+			if (index < adjacency.size()) {
+				adjacency[index].dirty = true;
+			}
+			break;
 		}
+		default:
+			return false;
 	}
 
-	return Node();
+	refreshAdjacency();
+	recordDelta(index, delta);
+	return true;
+}
+
+uint64_t Topology::getVersion(int index)
+{
+	// Read only -- a topology that never changed is at version 0
+	if (index < 0 || index >= changeLogs.size()) {
+		return 0;
+	}
+	return changeLogs[index].version;
+}
+
+void Topology::setVersion(int index, uint64_t version)
+{
+	if (index < 0) {
+		return;
+	}
+
+	// Deltas we hold don't lead to the new version, so start the log from it
+	ChangeLog& log = getChangeLog(index);
+	log.version = version;
+	log.firstVersion = version;
+	log.deltas.clear();
+}
+
+bool Topology::getDeltasSince(int index, uint64_t version, std::vector<Delta>& deltas)
+{
+	deltas.clear();
+	if (index < 0) {
+		return false;
+	}
+
+	// Never changed, so only version 0 is current
+	if (index >= changeLogs.size()) {
+		return version == 0;
+	}
+
+	const ChangeLog& log = changeLogs[index];
+	if (version == TOPOLOGY_VERSION_UNKNOWN || version < log.firstVersion || version > log.version) {
+		return false;
+	}
+
+	deltas.assign(log.deltas.begin() + (version - log.firstVersion), log.deltas.end());
+	return true;
+}
+
+Topology::ChangeLog& Topology::getChangeLog(int index)
+{
+	if (index >= changeLogs.size()) {
+		changeLogs.resize(index + 1);
+	}
+	return changeLogs[index];
+}
+
+void Topology::recordDelta(int index, const Delta& delta)
+{
+	ChangeLog& log = getChangeLog(index);
+	if (log.version == TOPOLOGY_VERSION_UNKNOWN) {
+		return;
+	}
+	log.deltas.push_back(delta);
+	log.version++;
+
+	// Drop the oldest delta once the log is full, peers that far behind get a snapshot instead
+	if (log.deltas.size() > TOPOLOGY_DELTA_LOG_SIZE) {
+		log.deltas.pop_front();
+		log.firstVersion++;
+	}
+}
+
+void Topology::restartChangeLog(int index)
+{
+	// Another instance's topology -- our copy no longer matches any of its versions
+	if (hostIndex >= 0 && index != hostIndex) {
+		setVersion(index, TOPOLOGY_VERSION_UNKNOWN);
+		return;
+	}
+
+	ChangeLog& log = getChangeLog(index);
+	log.version++;
+	log.firstVersion = log.version;
+	log.deltas.clear();
+}
+
+int Topology::getNodeID(const std::string& IP)
+{
+	uint32_t key;
+	if (!parseIPv4(IP, key)) {
+		return -1;
+	}
+
+	// IDs stay allocated after a node is removed, so also check it still has a location
+	auto it = nodeIDs.find(key);
+	if (it == nodeIDs.end() || nodeLocations[it->second].empty()) {
+		return -1;
+	}
+	return it->second;
+}
+
+Node Topology::getNodeByIP(std::string IP)
+{
+	NodeLocation location;
+	if (!findLocation(IP, -1, location)) {
+		return Node();
+	}
+
+	return topologyList[location.first][location.second];
 }
 
 Node Topology::getNodeByIP(std::string IP, int index)
 {
-	// Iterate through all nodes in the topology
-	for (int j = 0; j < topologyList[index].size(); j++) {
-		// If the IP matches, return the node
-		if (topologyList[index][j].getIP() == IP) {
-			return topologyList[index][j];
-		}
+	NodeLocation location;
+	if (!findLocation(IP, index, location)) {
+		return Node();
 	}
 
-	return Node();
+	return topologyList[location.first][location.second];
 }
 
 Node* Topology::getNodeReference(Node n)
 {
-	// Iterate through all topologies
-	for (int i = 0; i < topologyList.size(); i++) {
-		// Iterate through all nodes in the topology
-		for (int j = 0; j < topologyList[i].size(); j++) {
-			// If the IP matches, return the node
-			if (topologyList[i][j] == n) {
-				return &topologyList[i][j];
-			}
-		}
+	// Nodes compare by IP, so the first node holding that IP is the match
+	return getNodeReference(n.getIP());
+}
+
+Node* Topology::getNodeReference(const std::string& IP)
+{
+	NodeLocation location;
+	if (!findLocation(IP, -1, location)) {
+		return nullptr;
 	}
 
-	return nullptr;
+	// Edits made through the reference can't be logged, peers need a fresh snapshot
+	restartChangeLog(location.first);
+
+	return &topologyList[location.first][location.second];
+}
+
+const Node& Topology::getNodeView(const std::string& IP, int index)
+{
+	NodeLocation location;
+	if (!findLocation(IP, index, location)) {
+		return emptyNode;
+	}
+
+	return topologyList[location.first][location.second];
+}
+
+std::span<const Node> Topology::viewTopology(int index)
+{
+	// Ensure index exists
+	if (index < 0 || index >= topologyList.size()) {
+		return std::span<const Node>();
+	}
+
+	return std::span<const Node>(topologyList[index]);
 }
 
 std::vector<Node> Topology::getTopology(int index)
@@ -220,6 +506,10 @@ int Topology::getTopologyCount()
 void Topology::clear()
 {
 	topologyList.clear();
+	nodeIDs.clear();
+	nodeLocations.clear();
+	adjacency.clear();
+	changeLogs.clear();
 }
 
 Topology Topology::extractIndexTopology(int index)
@@ -231,6 +521,7 @@ Topology Topology::extractIndexTopology(int index)
 
 	Topology returnTopology;
 	returnTopology.topologyList.push_back(topologyList[index]);
+	returnTopology.rebuildIndex();
 
 	return returnTopology;
 }
@@ -292,13 +583,8 @@ bool Topology::isLocal(std::string IP, bool print)
 		return false;
 	}
 
-	for (Node n : topologyList[hostIndex]) {
-		if (n.getIP() == IP) {
-			return true;
-		}
-	}
-
-	return false;
+	NodeLocation location;
+	return findLocation(IP, hostIndex, location);
 }
 
 std::string Topology::printTopology(int index)
@@ -317,12 +603,324 @@ std::string Topology::printTopology(int index)
 }
 
 int Topology::getTopologyIndex(const std::string& ip) {
-    for (int i = 0; i < topologyList.size(); i++) {
-        for (Node& node : topologyList[i]) {
-            if (node.getIP() == ip) {
-                return i;
-            }
-        }
+    NodeLocation location;
+    if (!findLocation(ip, -1, location)) {
+        return -1; // Return -1 if IP not found in any topology
     }
-    return -1; // Return -1 if IP not found in any topology
-}
\ No newline at end of file
+    return location.first;
+}
+
+bool Topology::parseIPv4(const std::string& IP, uint32_t& key)
+{
+	// Dotted quad to host-order integer, rejects anything that isn't exactly four octets
+	uint32_t result = 0;
+	uint32_t octet = 0;
+	int digits = 0;
+	int dots = 0;
+
+	for (char c : IP) {
+		if (c >= '0' && c <= '9') {
+			octet = octet * 10 + (c - '0');
+			if (++digits > 3 || octet > 255) {
+				return false;
+			}
+		}
+		else if (c == '.' && digits > 0 && dots < 3) {
+			result = (result << 8) | octet;
+			octet = 0;
+			digits = 0;
+			dots++;
+		}
+		else {
+			return false;
+		}
+	}
+
+	if (dots != 3 || digits == 0) {
+		return false;
+	}
+
+	key = (result << 8) | octet;
+	return true;
+}
+
+bool Topology::findLocation(const std::string& IP, int index, NodeLocation& location)
+{
+	// index -1 means any topology -- the lowest one wins, matching a front-to-back scan
+	uint32_t key;
+	if (!parseIPv4(IP, key)) {
+		// Names that aren't IPv4 addresses aren't indexed, fall back to scanning for them
+		for (int i = 0; i < topologyList.size(); i++) {
+			if (index != -1 && i != index) {
+				continue;
+			}
+			for (int j = 0; j < topologyList[i].size(); j++) {
+				if (topologyList[i][j].getIP() == IP) {
+					location = NodeLocation(i, j);
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	auto it = nodeIDs.find(key);
+	if (it == nodeIDs.end()) {
+		return false;
+	}
+
+	for (const NodeLocation& candidate : nodeLocations[it->second]) {
+		if (index == -1 || candidate.first == index) {
+			location = candidate;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Topology::indexNode(int index, int position)
+{
+	uint32_t key;
+	if (!parseIPv4(topologyList[index][position].getIP(), key)) {
+		return;
+	}
+
+	// Keep locations sorted so the first entry is always the first match
+	std::vector<NodeLocation>& locations = nodeLocations[internIP(key)];
+	NodeLocation location(index, position);
+	locations.insert(std::upper_bound(locations.begin(), locations.end(), location), location);
+}
+
+void Topology::unindexNode(int index, int position)
+{
+	uint32_t key;
+	if (!parseIPv4(topologyList[index][position].getIP(), key)) {
+		return;
+	}
+
+	auto it = nodeIDs.find(key);
+	if (it == nodeIDs.end()) {
+		return;
+	}
+	std::vector<NodeLocation>& locations = nodeLocations[it->second];
+	locations.erase(std::remove(locations.begin(), locations.end(), NodeLocation(index, position)), locations.end());
+}
+
+void Topology::indexTopology(int index)
+{
+	for (int j = 0; j < topologyList[index].size(); j++) {
+		indexNode(index, j);
+	}
+}
+
+void Topology::unindexTopology(int index)
+{
+	// Drop this topology's locations, node IDs stay interned so they remain stable across updates
+	for (Node& n : topologyList[index]) {
+		uint32_t key;
+		if (!parseIPv4(n.getIP(), key)) {
+			continue;
+		}
+
+		auto it = nodeIDs.find(key);
+		if (it == nodeIDs.end()) {
+			continue;
+		}
+		std::vector<NodeLocation>& locations = nodeLocations[it->second];
+		locations.erase(std::remove_if(locations.begin(), locations.end(), [index](const NodeLocation& location) { return location.first == index; }), locations.end());
+	}
+}
+
+int Topology::internIP(uint32_t key)
+{
+	// Assign the next dense ID on first sight -- neighbours get IDs even before their node is added
+	auto it = nodeIDs.find(key);
+	if (it == nodeIDs.end()) {
+		it = nodeIDs.emplace(key, (int)nodeLocations.size()).first;
+		nodeLocations.emplace_back();
+	}
+	return it->second;
+}
+
+void Topology::rebuildIndex()
+{
+	nodeIDs.clear();
+	nodeLocations.clear();
+	adjacency.clear();
+	for (int i = 0; i < topologyList.size(); i++) {
+		indexTopology(i);
+	}
+	refreshAdjacency();
+}
+
+std::span<const Topology::Link> Topology::getAdjacency(int index, int position)
+{
+	// Ensure index and position exist in an up to date graph
+	if (index < 0 || index >= topologyList.size() || position < 0 || position >= topologyList[index].size()) {
+		return std::span<const Link>();
+	}
+	if (index >= adjacency.size() || adjacency[index].dirty) {
+		return std::span<const Link>();
+	}
+
+	const Adjacency& graph = adjacency[index];
+	return std::span<const Link>(graph.links.data() + graph.offsets[position], graph.offsets[position + 1] - graph.offsets[position]);
+}
+
+std::span<const Topology::Link> Topology::getAdjacency(const std::string& IP)
+{
+	NodeLocation location;
+	if (!findLocation(IP, -1, location)) {
+		return std::span<const Link>();
+	}
+
+	return getAdjacency(location.first, location.second);
+}
+
+bool Topology::isLinked(const std::string& srcIP, const std::string& dstIP)
+{
+	return findLink(srcIP, dstIP) != nullptr;
+}
+
+int Topology::getLinkCount(const std::string& IP, bool switchesOnly)
+{
+	NodeLocation location;
+	if (!findLocation(IP, -1, location)) {
+		return 0;
+	}
+
+	std::span<const Link> links = getAdjacency(location.first, location.second);
+	if (!switchesOnly) {
+		return (int)links.size();
+	}
+
+	// Only count neighbours that are switches
+	int count = 0;
+	for (size_t i = 0; i < links.size(); i++) {
+		NodeLocation neighbour;
+		if (links[i].nodeID >= 0) {
+			if (nodeLocations[links[i].nodeID].empty()) {
+				continue;
+			}
+			neighbour = nodeLocations[links[i].nodeID].front();
+		} else if (!findLocation(topologyList[location.first][location.second].getLinks()[i], -1, neighbour)) {
+			continue;
+		}
+
+		if (topologyList[neighbour.first][neighbour.second].isSwitch()) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int Topology::getLinkPort(const std::string& srcIP, const std::string& dstIP)
+{
+	const Link* link = findLink(srcIP, dstIP);
+	if (link == nullptr) {
+		return -1;
+	}
+
+	return link->outputPort;
+}
+
+const Topology::Link* Topology::findLink(const std::string& srcIP, const std::string& dstIP)
+{
+	NodeLocation location;
+	if (!findLocation(srcIP, -1, location)) {
+		return nullptr;
+	}
+
+	std::span<const Link> links = getAdjacency(location.first, location.second);
+
+	uint32_t key;
+	if (!parseIPv4(dstIP, key)) {
+		// Entries follow the node's link order, so a name that isn't indexed can be matched by position
+		const std::vector<std::string>& names = topologyList[location.first][location.second].getLinks();
+		for (size_t i = 0; i < names.size() && i < links.size(); i++) {
+			if (names[i] == dstIP) {
+				return &links[i];
+			}
+		}
+		return nullptr;
+	}
+
+	auto it = nodeIDs.find(key);
+	if (it == nodeIDs.end()) {
+		return nullptr;
+	}
+
+	for (const Link& link : links) {
+		if (link.nodeID == it->second) {
+			return &link;
+		}
+	}
+
+	return nullptr;
+}
+
+void Topology::buildAdjacency(int index)
+{
+	Adjacency& graph = adjacency[index];
+	graph.offsets.clear();
+	graph.links.clear();
+	graph.offsets.reserve(topologyList[index].size() + 1);
+	graph.offsets.push_back(0);
+
+	for (const Node& n : topologyList[index]) {
+		const std::vector<std::string>& names = n.getLinks();
+		for (size_t i = 0; i < names.size(); i++) {
+			Link link;
+			link.nodeID = -1;
+			link.topology = (uint8_t)index;
+			link.interDomain = 0;
+			// Port numbering: every link of the switch comes first, then 1-based link position
+			link.outputPort = (uint16_t)(names.size() + i + 1);
+
+			uint32_t key;
+			NodeLocation neighbour;
+			bool found = false;
+			if (parseIPv4(names[i], key)) {
+				link.nodeID = internIP(key);
+				if (!nodeLocations[link.nodeID].empty()) {
+					neighbour = nodeLocations[link.nodeID].front();
+					found = true;
+				}
+			} else {
+				found = findLocation(names[i], -1, neighbour);
+			}
+
+			// Inter-domain when the neighbour's first occurrence is in another topology
+			if (found && topologyList[neighbour.first][neighbour.second].getTopologyID() != n.getTopologyID()) {
+				link.interDomain = 1;
+			}
+
+			graph.links.push_back(link);
+		}
+		graph.offsets.push_back((uint32_t)graph.links.size());
+	}
+
+	graph.dirty = false;
+}
+
+void Topology::invalidateAdjacency()
+{
+	for (Adjacency& graph : adjacency) {
+		graph.dirty = true;
+	}
+}
+
+void Topology::refreshAdjacency()
+{
+	// Rebuilt by the writer straight away, queries only ever read the graph (and the node IDs it interns)
+	if (adjacency.size() < topologyList.size()) {
+		adjacency.resize(topologyList.size());
+	}
+	for (int i = 0; i < topologyList.size(); i++) {
+		if (adjacency[i].dirty) {
+			buildAdjacency(i);
+		}
+	}
+}
@@ -5,6 +5,17 @@
 #include "Log.h"
 #include <fstream>
 #include <sstream>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <span>
+#include <unordered_map>
+#include <deque>
+
+// Deltas kept per topology for peers catching up -- peers further behind get a full snapshot
+#define TOPOLOGY_DELTA_LOG_SIZE 256
+// Version of a topology copy that no longer matches any version of its owner (only a snapshot fixes it)
+#define TOPOLOGY_VERSION_UNKNOWN UINT64_MAX
 
 /// This class is a little confusing.
 ///
@@ -15,9 +26,43 @@
 /// 
 /// When nodes are added, they contain metadata that identifies which topology they belong to
 /// If the topology ID doesn't exist, a new topology is created
+///
+/// Lookups by IP go through an index instead of scanning every topology: each IPv4 address is interned
+/// to a dense node ID, and each node ID records where it sits in topologyList (a domain node can sit in
+/// more than one topology). The index is kept up to date by addNode/replaceTopology/clear, so callers
+/// must go through those rather than editing topologyList directly.
+///
+/// Links are also kept as a compressed sparse row graph per topology: one offsets array indexed by a node's
+/// position, pointing into one flat array of 8-byte Link entries over node IDs. Entries are in the same
+/// order as Node::getLinks(). The graph is rebuilt as part of every change (addNode/replaceTopology/applyDelta),
+/// so queries never write and any number of threads can query at once. Links must be changed through
+/// applyDelta -- getNodeReference is only for editing a node's flags.
+///
+/// Every topology also has a version and a bounded log of the deltas that produced it, so a peer that knows
+/// version v can be sent just the changes since v. Changes made through addNode/applyDelta are logged;
+/// replaceTopology and getNodeReference can't be described as deltas, so they bump the version and
+/// restart the log (peers behind that point need a snapshot). For copies of other instances' topologies
+/// the version mirrors the owner's, so such an edit leaves the copy at TOPOLOGY_VERSION_UNKNOWN instead.
 
 class Topology {
 	public:
+		// One adjacency entry -- a link from a node to its neighbour
+		struct Link {
+			int32_t		nodeID;			// Neighbour node ID, -1 if the neighbour isn't an IPv4 address
+			uint16_t	outputPort;		// Port on the owning switch that leads to the neighbour
+			uint8_t		topology;		// Topology the link belongs to
+			uint8_t		interDomain;	// Neighbour belongs to a different topology
+		};
+
+		// One change to a single topology, as exchanged in delta sync digests
+		struct Delta {
+			enum Op : uint8_t { NODE_ADD, NODE_REMOVE, LINK_ADD, LINK_REMOVE };
+
+			Op			op;
+			bool		isSwitch;		// NODE_ADD only
+			std::string	IP;				// Node the change applies to
+			std::vector<std::string> links;	// NODE_ADD: the node's links, LINK_ADD/LINK_REMOVE: the neighbour
+		};
 
 		// Equal operator (for finding dupes)
 		bool operator==(const Topology& other) const {
@@ -28,9 +73,36 @@ class Topology {
 		Node getNodeByIP(std::string IP);
 		Node getNodeByIP(std::string IP, int index);
 		Node* getNodeReference(Node n);
+		Node* getNodeReference(const std::string& IP);
+
+		// Read-only views -- no copies, valid until the topology is next modified
+		// The reactor thread modifies the shared topology at any time, so other threads only use a view within one expression
+		// getNodeView returns an empty node (isEmptyNode) when the IP isn't found, index -1 searches every topology
+		const Node& getNodeView(const std::string& IP, int index = -1);
+		std::span<const Node> viewTopology(int index);
 
 		// Add node to topology
 		bool addNode(Node node);
+		// Replace every node of a single topology (used when a peer sends an updated topology)
+		void replaceTopology(int index, std::vector<Node> nodes);
+
+		// Apply a change to one topology and log it, returns false (nothing changes) if it doesn't apply
+		bool applyDelta(int index, const Delta& delta);
+
+		// Versioning -- getDeltasSince returns false if version isn't covered by the log (snapshot needed)
+		uint64_t getVersion(int index);
+		void setVersion(int index, uint64_t version);
+		bool getDeltasSince(int index, uint64_t version, std::vector<Delta>& deltas);
+
+		// Dense ID of the node with this IP, -1 if the IP isn't in any topology
+		int getNodeID(const std::string& IP);
+
+		// Link queries over the adjacency graph (IP lookups resolve to the first node holding that IP)
+		std::span<const Link> getAdjacency(int index, int position);
+		std::span<const Link> getAdjacency(const std::string& IP);
+		bool isLinked(const std::string& srcIP, const std::string& dstIP);
+		int getLinkCount(const std::string& IP, bool switchesOnly);
+		int getLinkPort(const std::string& srcIP, const std::string& dstIP);
 
 		// Get and print topology data
 		std::vector<Node> getTopology(int index);
@@ -48,11 +120,13 @@ class Topology {
 		// Marshalling functions
 		static std::vector<Node> string_toTopology(std::string payload);
 		std::string topology_toString(int index);
+		static std::string deltas_toString(const std::vector<Delta>& deltas);
+		static bool string_toDeltas(const std::string& payload, std::vector<Delta>& deltas);
 
 		// Variables
 		std::vector<std::vector<Node>> topologyList;
 		bool verified;
-		int hostIndex;
+		int hostIndex = -1;
 		
 		int getTopologyIndex(const std::string& ip);
 
@@ -61,6 +135,48 @@ class Topology {
 		// Each node understands which domain/topology it belongs to based on Node.topologyIndex
 
 	private:
+		// Where a node lives in topologyList
+		typedef std::pair<int, int> NodeLocation; // (topology index, position)
+
+		static const Node emptyNode;
+
+		static bool parseIPv4(const std::string& IP, uint32_t& key);
+		bool findLocation(const std::string& IP, int index, NodeLocation& location);
+		void indexNode(int index, int position);
+		void unindexNode(int index, int position);
+		void indexTopology(int index);
+		void unindexTopology(int index);
+		void rebuildIndex();
+		int internIP(uint32_t key);
+
+		// Per topology CSR graph, links of the node at position p are links[offsets[p]..offsets[p + 1])
+		struct Adjacency {
+			std::vector<uint32_t> offsets;
+			std::vector<Link> links;
+			bool dirty = true;
+		};
+
+		const Link* findLink(const std::string& srcIP, const std::string& dstIP);
+		void buildAdjacency(int index);
+		void invalidateAdjacency();
+		void refreshAdjacency();
+
+		// Version of a topology and the deltas leading up to it, deltas[i] moves firstVersion + i to firstVersion + i + 1
+		struct ChangeLog {
+			uint64_t version = 0;
+			uint64_t firstVersion = 0;
+			std::deque<Delta> deltas;
+		};
+
+		ChangeLog& getChangeLog(int index);
+		void recordDelta(int index, const Delta& delta);
+		void restartChangeLog(int index);
+
+		// IPv4 (host order) -> node ID, node ID -> locations sorted by topology index
+		std::unordered_map<uint32_t, int> nodeIDs;
+		std::vector<std::vector<NodeLocation>> nodeLocations;
+		std::vector<Adjacency> adjacency;
+		std::vector<ChangeLog> changeLogs;
 };
 
 #endif
\ No newline at end of file
@@ -17,12 +17,18 @@ def start_veriflow_server(host, port):
 	global client_socket
 
 	def handle_client(client_socket):
+		pending = ""
 		try:
 			while True:
-				msg = client_socket.recv(1024).decode('utf-8')
-				if not msg:
+				data = client_socket.recv(4096).decode('utf-8')
+				if not data:
 					break
-				parse_message(msg, client_socket)
+
+				# Packets are null-terminated -- batches can span several reads, so only parse complete ones
+				pending += data
+				complete, sep, pending = pending.rpartition('\x00')
+				if sep:
+					parse_message(complete, client_socket)
 
 		except Exception as e:
 			print("\nError handling client: {}".format(e))
@@ -69,6 +75,12 @@ def start_veriflow_server(host, port):
 				if "Hello" in packet:
 					print("\nReceived hello message from CCPDN!")
 					client_socket.send("[VERIFLOW] Hello".encode('utf-8'))
+				## Handle logic for a batch of flow rules
+				## FORMAT: [CCPDN] BATCH 0=A#192.168.0.0-0.0.0.0/0-192.168.0.1;1=R#...
+				elif packet.startswith("[CCPDN] BATCH"):
+					print("\nReceived FLOW Batch from CCPDN!")
+					msg = packet[8:].strip()
+					pingFlag.set()
 				## Handle logic for a flow rule added
 				elif "FLOW" in packet:
 					## Only parse characters after the text "[CCPDN] FLOW "
@@ -88,6 +100,38 @@ def checkPythonVersion():
 		print("This script requires Python 3.x")
 		sys.exit(1)
 
+def applyRule(network, rule):
+	## Apply a single A#/R# rule to the network, returns True if the network stays well-formed (None on bad input)
+	affectedEcs = set()
+	if (rule.startswith("A")):
+		affectedEcs = network.addRuleFromString(rule[2:])
+		result = network.checkWellformedness(affectedEcs) is True
+		print("Rule added successfully!" if result else "Rule addition failed!")
+	elif (rule.startswith("R")):
+		affectedEcs = network.deleteRuleFromString(rule[2:])
+		result = network.checkWellformedness(affectedEcs) is True
+		print("Rule deleted successfully!" if result else "Rule deletion failed!")
+	else:
+		print("Wrong input on packet!")
+		return None
+
+	print("")
+	network.log(affectedEcs)
+	return result
+
+def applyBatch(network, batch):
+	## Apply every rule in a batch in order, reply with one result per flow ID
+	## FORMAT: [VERIFLOW] BATCH 0=S;1=F
+	results = []
+	for entry in batch[len("BATCH "):].split(';'):
+		flowId, sep, rule = entry.partition('=')
+		if not sep:
+			continue
+		result = applyRule(network, rule.strip())
+		results.append("{}={}".format(flowId.strip(), "S" if result else "F"))
+
+	return "[VERIFLOW] BATCH " + ";".join(results) + "\n"
+
 def main():
 	global msg
 	global client_socket
@@ -123,29 +167,18 @@ def main():
 		pingFlag.clear()
 
 		if msg is not None:
-			affectedEcs = set()
-			if (msg.startswith("A")):
-				affectedEcs = network.addRuleFromString(msg[2:])
-				if network.checkWellformedness(affectedEcs) is True:
-					print("Rule added successfully!")
+			if (msg.startswith("BATCH")):
+				client_socket.sendall(applyBatch(network, msg).encode('utf-8'))
+			else:
+				result = applyRule(network, msg)
+				if result is True:
 					client_socket.send("[VERIFLOW] Success".encode('utf-8'))
-				else:
-					print("Rule addition failed!")
+				elif result is False:
 					client_socket.send("[VERIFLOW] Fail".encode('utf-8'))
-			elif (msg.startswith("R")):
-				affectedEcs = network.deleteRuleFromString(msg[2:])
-				if network.checkWellformedness(affectedEcs) is True:
-					print("Rule deleted successfully!")
-					client_socket.send("[VERIFLOW] Success".encode('utf-8'))
 				else:
-					print("Rule deletion failed!")
-					client_socket.send("[VERIFLOW] Fail".encode('utf-8'))
-			else:
-				print("Wrong input on packet!")
-				continue
+					msg = None
+					continue
 
-			print("")
-			network.log(affectedEcs)
 			msg = None
 
 if __name__ == '__main__':